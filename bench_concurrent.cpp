@@ -0,0 +1,224 @@
+// Stress test and throughput of concurrent_radix_tree and sharded_radix_tree against radix_tree behind one mutex.
+//
+//   g++ -O2 -std=c++17 -pthread bench_concurrent.cpp -o bench_concurrent
+//   ./bench_concurrent [number of keys] [max threads]
+//
+// stress - every thread inserts and erases keys of its own while readers look up
+//          keys that are never erased; each thread checks it always sees its own
+//          writes and the stable keys, the final contents are checked at the end
+// read   - 90% find, 5% insert, 5% erase over a preloaded key set
+// mixed  - 50% find, 25% insert, 25% erase
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "radix_tree.hpp"
+#include "radix_tree_concurrent.hpp"
+#include "radix_tree_sharded.hpp"
+
+typedef concurrent_radix_tree<std::string, int> concurrent_type;
+typedef radix_tree<std::string, int> tree_type;
+typedef sharded_radix_tree<std::string, int> sharded_type;
+
+// both trees behind the same interface so one driver runs them
+struct concurrent_map {
+    concurrent_type tree;
+
+    bool find(const std::string& key, int& value) { return tree.find(key, value); }
+    bool insert(const std::string& key, int value) { return tree.insert(concurrent_type::value_type(key, value)); }
+    bool erase(const std::string& key) { return tree.erase(key); }
+};
+
+// the URL keys all start with "http", so shard by a hash over enough bytes to reach past the host
+struct sharded_map {
+    sharded_type tree;
+
+    sharded_map() : tree(64, 24, radix_shard_by_hash) { }
+    bool find(const std::string& key, int& value) { return tree.find(key, value); }
+    bool insert(const std::string& key, int value) { return tree.insert(sharded_type::value_type(key, value)); }
+    bool erase(const std::string& key) { return tree.erase(key); }
+};
+
+struct mutex_map {
+    std::mutex mutex;
+    tree_type tree;
+
+    bool find(const std::string& key, int& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tree_type::iterator it = tree.find(key);
+        if (it == tree.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+    bool insert(const std::string& key, int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tree.insert(tree_type::value_type(key, value)).second;
+    }
+    bool erase(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tree.erase(key);
+    }
+};
+
+// URL-like keys with long shared prefixes, so inserts split and erases merge inner nodes
+static std::vector<std::string> make_keys(std::size_t n, unsigned seed)
+{
+    static const char* hosts[] = { "http://example.com/", "http://example.org/static/", "https://api.example.net/v1/users/", "https://cdn.example.io/assets/img/" };
+    std::mt19937 rng(seed);
+    std::vector<std::string> keys;
+
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string key = hosts[rng() % 4];
+        int segments = 1 + rng() % 3;
+        for (int s = 0; s < segments; ++s) {
+            int len = 1 + rng() % 6;
+            for (int c = 0; c < len; ++c)
+                key += static_cast<char>('a' + rng() % 4);
+            key += '/';
+        }
+        keys.push_back(key);
+    }
+
+    return keys;
+}
+
+static bool stress(unsigned threads, std::size_t n)
+{
+    concurrent_type tree;
+    std::vector<std::string> stable = make_keys(n / 4, 1);
+    std::vector<std::string> own = make_keys(n, 2);
+    std::atomic<bool> failed(false);
+
+    for (std::size_t i = 0; i < stable.size(); ++i)
+        tree.insert(concurrent_type::value_type(stable[i] + "#", -1));
+
+    // thread t owns the own keys with index % threads == t, so only it changes them
+    std::vector<std::vector<char> > present(threads, std::vector<char>(own.size(), 0));
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+            std::mt19937 rng(100 + t);
+            std::vector<char>& mine = present[t];
+            for (int op = 0; op < 200000 && !failed; ++op) {
+                std::size_t i = rng() % own.size();
+                int value;
+                if (i % threads != t) {
+                    const std::string& key = stable[i % stable.size()];
+                    if (!tree.find(key + "#", value) || value != -1)
+                        failed = true;
+                    continue;
+                }
+                std::string key = own[i] + std::to_string(i);
+                if (rng() % 2) {
+                    if (tree.insert(concurrent_type::value_type(key, static_cast<int>(i))) == (mine[i] != 0))
+                        failed = true;
+                    mine[i] = 1;
+                }
+                else {
+                    if (tree.erase(key) != (mine[i] != 0))
+                        failed = true;
+                    mine[i] = 0;
+                }
+                if (tree.find(key, value) != (mine[i] != 0) || (mine[i] && value != static_cast<int>(i)))
+                    failed = true;
+            }
+        }));
+    }
+    for (unsigned t = 0; t < threads; ++t)
+        workers[t].join();
+
+    std::size_t expected = 0;
+    std::vector<concurrent_type::value_type> all;
+    tree.prefix_match(std::string(), all);
+    for (unsigned t = 0; t < threads; ++t) {
+        for (std::size_t i = 0; i < own.size(); ++i) {
+            int value;
+            if (present[t][i]) {
+                ++expected;
+                if (!tree.find(own[i] + std::to_string(i), value))
+                    failed = true;
+            }
+        }
+    }
+    // stable keys can repeat, the tree holds each once
+    expected += std::set<std::string>(stable.begin(), stable.end()).size();
+    return !failed && all.size() == expected && tree.size() == expected;
+}
+
+template<class Map>
+static double throughput(Map& map, const std::vector<std::string>& keys, unsigned threads, int read_percent)
+{
+    const int ops = 400000;
+    std::vector<std::thread> workers;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+            std::mt19937 rng(7 + t);
+            int value;
+            for (int op = 0; op < ops; ++op) {
+                const std::string& key = keys[rng() % keys.size()];
+                int kind = rng() % 100;
+                if (kind < read_percent)
+                    map.find(key, value);
+                else if (kind < read_percent + (100 - read_percent) / 2)
+                    map.insert(key, op);
+                else
+                    map.erase(key);
+            }
+        }));
+    }
+    for (unsigned t = 0; t < threads; ++t)
+        workers[t].join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return threads * static_cast<double>(ops) / seconds / 1e6;
+}
+
+template<class Map>
+static void preload(Map& map, const std::vector<std::string>& keys)
+{
+    for (std::size_t i = 0; i < keys.size(); i += 2)
+        map.insert(keys[i], static_cast<int>(i));
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 200000;
+    unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], NULL, 10)) : std::thread::hardware_concurrency();
+    if (max_threads == 0)
+        max_threads = 1;
+
+    bool ok = stress(max_threads < 2 ? 2 : max_threads, n / 10);
+    std::cout << "stress: " << (ok ? "ok" : "FAILED") << std::endl;
+
+    std::vector<std::string> keys = make_keys(n, 3);
+    const int mixes[] = { 90, 50 };
+    for (int m = 0; m < 2; ++m) {
+        std::cout << (mixes[m] == 90 ? "read" : "mixed") << ":" << std::endl;
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            concurrent_map concurrent;
+            sharded_map sharded;
+            mutex_map locked;
+            preload(concurrent, keys);
+            preload(sharded, keys);
+            preload(locked, keys);
+            double c = throughput(concurrent, keys, threads, mixes[m]);
+            double s = throughput(sharded, keys, threads, mixes[m]);
+            double l = throughput(locked, keys, threads, mixes[m]);
+            std::cout << "  " << threads << " threads: concurrent " << c << " Mops/s, sharded " << s << " Mops/s, mutex " << l << " Mops/s" << std::endl;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+// Insert throughput and teardown time of radix_tree with and without slab allocation.
+//
+//   g++ -O2 -std=c++11 bench_pool.cpp -o bench_pool
+//   ./bench_pool [number of keys]
+//
+// heap   - pass-through pool, every node, child block and label is its own heap block
+// shared - slab pool shared with the caller, clear() returns nodes to the free lists one by one
+// owned  - slab pool owned by the tree, clear() releases the whole pool at once
+// defer  - as owned, with a radix_tree_reclaimer: clear() hands the pool to the reclaimer's
+//          thread, which destroys the stored keys and frees it; the time is that of the caller
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radix_tree.hpp"
+
+typedef radix_tree<std::string, int> tree_type;
+
+// short keys fit in std::string's inline buffer, so only the tree itself allocates
+static std::vector<std::string> make_words(std::size_t n)
+{
+    std::mt19937 rng(54321);
+    std::vector<std::string> keys;
+
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        int len = 4 + rng() % 10;
+        std::string key;
+        for (int c = 0; c < len; ++c)
+            key += static_cast<char>('a' + rng() % 26);
+        keys.push_back(key);
+    }
+
+    return keys;
+}
+
+static std::vector<std::string> make_urls(std::size_t n)
+{
+    static const char* hosts[] = { "http://example.com/", "http://example.org/static/", "https://api.example.net/v1/users/", "https://cdn.example.io/assets/img/" };
+    std::mt19937 rng(12345);
+    std::vector<std::string> keys;
+
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string key = hosts[rng() % 4];
+        int segments = 1 + rng() % 4;
+        for (int s = 0; s < segments; ++s) {
+            int len = 3 + rng() % 8;
+            for (int c = 0; c < len; ++c)
+                key += static_cast<char>('a' + rng() % 26);
+            key += '/';
+        }
+        keys.push_back(key);
+    }
+
+    return keys;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run(const char* name, tree_type& tree, const std::vector<std::string>& keys)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        tree.insert(tree_type::value_type(keys[i], static_cast<int>(i)));
+    double insert_time = seconds_since(start);
+
+    std::size_t size = tree.size();
+
+    start = std::chrono::steady_clock::now();
+    tree.clear();
+    double clear_time = seconds_since(start);
+
+    std::cout << name << ": " << size << " keys, insert " << keys.size() / insert_time / 1e6 << " Mops/s, clear " << clear_time * 1e3 << " ms" << std::endl;
+}
+
+static void compare(const std::vector<std::string>& keys)
+{
+    {
+        radix_tree_pool pool(0);
+        tree_type tree(pool);
+        run("heap  ", tree, keys);
+    }
+    {
+        radix_tree_pool pool;
+        tree_type tree(pool);
+        run("shared", tree, keys);
+    }
+    {
+        tree_type tree;
+        run("owned ", tree, keys);
+    }
+    {
+        radix_tree_reclaimer reclaimer;
+        tree_type tree;
+        tree.set_reclaimer(&reclaimer);
+        run("defer ", tree, keys);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+    std::vector<std::string> words = make_words(n);
+    std::vector<std::string> urls = make_urls(n);
+
+    std::cout << "words:" << std::endl;
+    compare(words);
+    std::cout << "urls:" << std::endl;
+    compare(urls);
+
+    return EXIT_SUCCESS;
+}
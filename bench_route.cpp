@@ -0,0 +1,190 @@
+// IPv4 longest-prefix match on a full-table-sized route set.
+//
+//   cmake -S . -B build && cmake --build build && ./build/bench_route
+//   g++ -O2 -std=c++17 bench_route.cpp -o bench_route
+//
+//   ./bench_route [--routes number of routes] [--lookups number of lookups] [--file path] [--seed seed]
+//
+// The route set is --file, one a.b.c.d/len per line as in a routing table dump,
+// or a synthetic table shaped like the public IPv4 table: about 950,000 routes,
+// six in ten of them /24, most of the rest /16 to /23, drawn from a few thousand
+// allocated /12 blocks so that more-specifics nest inside shorter routes. The
+// lookups are addresses inside random routes, so nearly every one matches.
+//
+// 16-8-8  radix_ipv4_table, at most three table loads per lookup
+// 16-4x4  radix_route_table with 4-bit strides below the first 16 bits, smaller
+//         tables for sparse /16s but up to five loads
+// bits    radix_tree<std::string, int> over the prefix written as '0' and '1'
+//         characters, one character per bit, with longest_match
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radix_tree.hpp"
+#include "radix_tree_route.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct route {
+    std::uint32_t prefix;
+    int len;
+};
+
+static double seconds_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// the share in ten thousand of each prefix length in the public table
+static const int length_shares[33] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 5, 10, 25, 45, 60,
+    140, 80, 130, 250, 400, 500, 1200, 1000, 6150, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static std::vector<route> make_routes(std::size_t n, std::mt19937& rng)
+{
+    std::vector<std::uint32_t> blocks;
+    for (int i = 0; i < 4000; ++i) {
+        // unicast space, 1.0.0.0 to 223.255.255.255
+        std::uint32_t a = (1 + rng() % 223) << 24 | (rng() & 0x00f00000u);
+        blocks.push_back(a);
+    }
+
+    std::vector<int> lengths;
+    for (int len = 0; len <= 32; ++len)
+        lengths.insert(lengths.end(), length_shares[len], len);
+
+    std::vector<route> routes;
+    radix_ipv4_table<char> seen;
+    while (routes.size() < n) {
+        int len = lengths[rng() % lengths.size()];
+        std::uint32_t a = blocks[rng() % blocks.size()] | (rng() & 0x000fffffu);
+        if (len < 12)
+            a = blocks[rng() % blocks.size()];
+        route r = { radix_route_key<std::uint32_t>::mask(a, len), len };
+        if (seen.insert(r.prefix, r.len, 0))
+            routes.push_back(r);
+    }
+    return routes;
+}
+
+static std::vector<route> read_routes(const std::string& file)
+{
+    std::vector<route> routes;
+    std::ifstream in(file.c_str());
+    std::string line;
+
+    while (std::getline(in, line)) {
+        unsigned a, b, c, d;
+        int len;
+        if (std::sscanf(line.c_str(), "%u.%u.%u.%u/%d", &a, &b, &c, &d, &len) == 5 && len >= 0 && len <= 32) {
+            route r = { radix_route_key<std::uint32_t>::mask(a << 24 | b << 16 | c << 8 | d, len), len };
+            routes.push_back(r);
+        }
+    }
+    return routes;
+}
+
+static std::string bits(std::uint32_t a, int len)
+{
+    std::string s(len, '0');
+    for (int i = 0; i < len; ++i)
+        if (a & (std::uint32_t(1) << (31 - i)))
+            s[i] = '1';
+    return s;
+}
+
+template<class Table>
+static void run_table(const char* name, const std::vector<route>& routes, const std::vector<std::uint32_t>& addresses)
+{
+    Table table;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (std::size_t i = 0; i < routes.size(); ++i)
+        table.insert(routes[i].prefix, routes[i].len, static_cast<int>(i));
+    double build = seconds_since(start);
+
+    long sink = 0;
+    start = bench_clock::now();
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+        const int* value = table.longest_match(addresses[i]);
+        sink += value != NULL ? *value : -1;
+    }
+    double lookup = seconds_since(start);
+
+    std::printf("  %-8s %8.2f s build %9.2f Mlookups/s %9.1f MB %8.1f bytes/route   (%ld)\n", name, build,
+        addresses.size() / lookup / 1e6, table.bytes() / 1e6, static_cast<double>(table.bytes()) / table.size(), sink);
+}
+
+static void run_bits(const std::vector<route>& routes, const std::vector<std::uint32_t>& addresses)
+{
+    radix_tree<std::string, int> tree;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (std::size_t i = 0; i < routes.size(); ++i)
+        tree.insert(radix_tree<std::string, int>::value_type(bits(routes[i].prefix, routes[i].len), static_cast<int>(i)));
+    double build = seconds_since(start);
+
+    // the key is built outside the timed loop, it is not part of the lookup
+    std::vector<std::string> keys;
+    keys.reserve(addresses.size());
+    for (std::size_t i = 0; i < addresses.size(); ++i)
+        keys.push_back(bits(addresses[i], 32));
+
+    long sink = 0;
+    start = bench_clock::now();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        radix_tree<std::string, int>::iterator it = tree.longest_match(keys[i]);
+        sink += it != tree.end() ? it->second : -1;
+    }
+    double lookup = seconds_since(start);
+
+    radix_tree_stats st = tree.stats();
+    std::printf("  %-8s %8.2f s build %9.2f Mlookups/s %9.1f MB %8.1f bytes/route   (%ld)\n", "bits", build,
+        keys.size() / lookup / 1e6, st.heap_bytes / 1e6, static_cast<double>(st.heap_bytes) / tree.size(), sink);
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = 950000;
+    std::size_t lookups = 10000000;
+    std::string file;
+    unsigned seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--routes") == 0)
+            n = std::strtoul(argv[i + 1], NULL, 10);
+        else if (std::strcmp(argv[i], "--lookups") == 0)
+            lookups = std::strtoul(argv[i + 1], NULL, 10);
+        else if (std::strcmp(argv[i], "--file") == 0)
+            file = argv[i + 1];
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = static_cast<unsigned>(std::strtoul(argv[i + 1], NULL, 10));
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<route> routes = file.empty() ? make_routes(n, rng) : read_routes(file);
+    if (routes.empty()) {
+        std::printf("no routes in %s\n", file.c_str());
+        return 1;
+    }
+
+    std::vector<std::uint32_t> addresses;
+    addresses.reserve(lookups);
+    for (std::size_t i = 0; i < lookups; ++i) {
+        const route& r = routes[rng() % routes.size()];
+        std::uint32_t host = r.len == 32 ? 0 : rng() & (~std::uint32_t(0) >> r.len);
+        addresses.push_back(r.prefix | host);
+    }
+
+    std::printf("# %zu routes, %zu lookups\n", routes.size(), addresses.size());
+    run_table<radix_ipv4_table<int> >("16-8-8", routes, addresses);
+    run_table<radix_route_table<std::uint32_t, int, 16, 4, 4, 4, 4> >("16-4x4", routes, addresses);
+    run_bits(routes, addresses);
+
+    return 0;
+}
@@ -0,0 +1,572 @@
+// Throughput, latency and memory of radix_tree against std::map and std::unordered_map.
+//
+//   cmake -S . -B build && cmake --build build && ./build/bench_suite
+//   g++ -O2 -std=c++17 bench_suite.cpp -o bench_suite
+//
+//   ./bench_suite [--keys random|url|ip|dict|all] [--file path] [--dist uniform|zipf|all]
+//                 [--n number of keys] [--ops number of operations] [--theta zipf skew] [--seed seed]
+//
+// key sets - random: 8 to 32 random letters
+//            url:    scheme, one of a few hundred hosts, two to four path segments
+//            ip:     dotted IPv4 addresses drawn from a few hundred /16 networks
+//            dict:   the lines of --file, /usr/share/dict/words by default, or
+//                    synthetic words built from syllables when neither can be read
+// access   - uniform, or Zipfian with skew theta over a random ranking of the keys
+//
+// For every key set and distribution each structure is built by inserting the keys
+// in random order, queried, iterated and emptied again. Every operation is run twice:
+// once untimed in a tight loop for throughput, once with a clock read around each
+// call for the p50/p99 latency, which therefore includes the cost of the clock
+// itself (printed at the start). Queries of the match operations:
+//
+//   find            a stored key
+//   find_batch      the find queries, 256 per call to radix_tree::find_batch
+//   longest_match   a stored key with a random suffix, so the key itself is the answer
+//   prefix_match    the first half of a stored key, at most 16 results
+//   count_prefix    the prefix_match queries, the number of keys starting with them
+//   greedy_match    a stored key with its last byte changed, at most 16 results
+//   range_scan      the greedy_match queries as lower bounds, the next 16 keys in order
+//   fuzzy_match     the greedy_match queries within one edit, at most 16 results
+//
+// std::map answers prefix_match by a lower_bound scan and longest_match by one
+// lookup per prefix length, std::unordered_map only the latter and no range_scan;
+// greedy_match and fuzzy_match are radix_tree only. radix_tree counts prefixes by walking
+// the matches unless built with -DRADIX_TREE_SUBTREE_COUNTS. Bytes per key is the growth of the live heap while the keys are
+// inserted, measured by counting operator new, so it includes the keys themselves.
+// For radix_tree the shape from radix_tree::stats() follows; built with
+// -DRADIX_TREE_COUNTERS it also prints the hot-path counters of the run.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define BENCH_HEAP_BYTES
+#endif
+
+#include "radix_tree.hpp"
+
+#if defined(BENCH_HEAP_BYTES)
+static std::size_t g_live_bytes = 0;
+
+void* operator new(std::size_t n)
+{
+    void* p = std::malloc(n != 0 ? n : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    g_live_bytes += malloc_usable_size(p);
+    return p;
+}
+
+// GCC inlines this into callers of operator new and then takes the free() for a mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept
+{
+    if (p != NULL) {
+        g_live_bytes -= malloc_usable_size(p);
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+#endif
+
+static std::size_t live_bytes()
+{
+#if defined(BENCH_HEAP_BYTES)
+    return g_live_bytes;
+#else
+    return 0;
+#endif
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static const std::size_t match_limit = 16;
+static const std::size_t batch_size = 256;
+
+// the structures behind one interface; an operation a structure cannot answer returns false from supports()
+struct radix_adapter {
+    typedef radix_tree<std::string, int> tree_type;
+    static const char* name() { return "radix_tree"; }
+    static bool supports(const std::string&) { return true; }
+
+    tree_type tree;
+    std::vector<tree_type::iterator> matches;
+    std::vector<tree_type::iterator> found;
+
+    bool insert(const std::string& key, int value) { return tree.insert(tree_type::value_type(key, value)).second; }
+    bool find(const std::string& key) { return tree.find(key) != tree.end(); }
+    bool erase(const std::string& key) { return tree.erase(key); }
+    std::size_t longest_match(const std::string& key) { return tree.longest_match(key) != tree.end(); }
+    std::size_t prefix_match(const std::string& key) { tree.prefix_match(key, matches, match_limit); return matches.size(); }
+    std::size_t count_prefix(const std::string& key) { return tree.count_prefix(key); }
+    std::size_t greedy_match(const std::string& key) { tree.greedy_match(key, matches, match_limit); return matches.size(); }
+    std::size_t range_scan(const std::string& key) {
+        std::size_t count = 0;
+        for (tree_type::iterator it = tree.lower_bound(key); it != tree.end() && count < match_limit; ++it)
+            count++;
+        return count;
+    }
+    std::size_t fuzzy_match(const std::string& key) {
+        std::size_t count = 0;
+        return tree.fuzzy_match(key, 1, [&count](tree_type::iterator, int) { return ++count < match_limit; });
+    }
+    std::size_t find_batch(const std::string* keys, std::size_t count) {
+        std::size_t hits = 0;
+        found.resize(count);
+        tree.find_batch(keys, count, found.data());
+        for (std::size_t i = 0; i < count; ++i)
+            hits += found[i] != tree.end();
+        return hits;
+    }
+    long iterate() {
+        long sum = 0;
+        for (tree_type::iterator it = tree.begin(); it != tree.end(); ++it)
+            sum += it->second;
+        return sum;
+    }
+    // shape of the built tree, and with RADIX_TREE_COUNTERS what the operations so far cost
+    void describe() const {
+        radix_tree_stats st = tree.stats();
+        double depth = 0;
+        for (std::size_t d = 0; d < st.depths.size(); ++d)
+            depth += static_cast<double>(d) * st.depths[d];
+        std::printf("  %-19s %-14s %zu nodes, %zu leaves, depth %.1f average %zu max, %.1f heap bytes/key\n", name(), "shape",
+            st.nodes, st.leaves, depth / st.nodes, st.depths.size() - 1, static_cast<double>(st.heap_bytes) / st.values);
+        std::printf("  %-19s %-14s %.1f node + %.1f child index + %.1f label bytes/key (%.1f packed in an arena), %.0f%% of labels inside the node\n",
+            name(), "layout", static_cast<double>(st.node_bytes) / st.values, static_cast<double>(st.child_bytes) / st.values,
+            static_cast<double>(st.label_bytes) / st.values, static_cast<double>(st.label_arena_bytes) / st.values,
+            st.nodes > 1 ? 100.0 * st.inline_labels / (st.nodes - 1) : 0.0);
+#ifdef RADIX_TREE_COUNTERS
+        radix_tree_counters c = tree.counters();
+        std::printf("  %-19s %-14s %.2f levels/lookup, %zu splits, %zu merges, %.2f allocations/write\n", name(), "counters",
+            static_cast<double>(c.levels) / c.lookups, c.splits, c.merges, static_cast<double>(c.allocations) / (c.inserts + c.erases));
+#endif
+    }
+};
+
+struct map_adapter {
+    typedef std::map<std::string, int, std::less<> > map_type;
+    static const char* name() { return "std::map"; }
+    static bool supports(const std::string& op) { return op != "greedy_match" && op != "fuzzy_match" && op != "find_batch"; }
+
+    map_type map;
+
+    bool insert(const std::string& key, int value) { return map.insert(map_type::value_type(key, value)).second; }
+    bool find(const std::string& key) { return map.find(key) != map.end(); }
+    bool erase(const std::string& key) { return map.erase(key) != 0; }
+    std::size_t longest_match(const std::string& key) {
+        for (std::size_t len = key.size() + 1; len-- != 0; ) {
+            if (map.find(std::string_view(key.data(), len)) != map.end())
+                return 1;
+        }
+        return 0;
+    }
+    std::size_t prefix_match(const std::string& key) {
+        std::size_t count = 0;
+        for (map_type::iterator it = map.lower_bound(key); it != map.end() && count < match_limit && it->first.compare(0, key.size(), key) == 0; ++it)
+            count++;
+        return count;
+    }
+    std::size_t count_prefix(const std::string& key) {
+        std::size_t count = 0;
+        for (map_type::iterator it = map.lower_bound(key); it != map.end() && it->first.compare(0, key.size(), key) == 0; ++it)
+            count++;
+        return count;
+    }
+    std::size_t greedy_match(const std::string&) { return 0; }
+    std::size_t range_scan(const std::string& key) {
+        std::size_t count = 0;
+        for (map_type::iterator it = map.lower_bound(key); it != map.end() && count < match_limit; ++it)
+            count++;
+        return count;
+    }
+    std::size_t fuzzy_match(const std::string&) { return 0; }
+    std::size_t find_batch(const std::string*, std::size_t) { return 0; }
+    void describe() const { }
+    long iterate() {
+        long sum = 0;
+        for (map_type::iterator it = map.begin(); it != map.end(); ++it)
+            sum += it->second;
+        return sum;
+    }
+};
+
+struct unordered_adapter {
+    typedef std::unordered_map<std::string, int> map_type;
+    static const char* name() { return "std::unordered_map"; }
+    static bool supports(const std::string& op) { return op != "prefix_match" && op != "count_prefix" && op != "greedy_match" && op != "range_scan" && op != "fuzzy_match" && op != "find_batch"; }
+
+    map_type map;
+    std::string prefix;
+
+    bool insert(const std::string& key, int value) { return map.insert(map_type::value_type(key, value)).second; }
+    bool find(const std::string& key) { return map.find(key) != map.end(); }
+    bool erase(const std::string& key) { return map.erase(key) != 0; }
+    std::size_t longest_match(const std::string& key) {
+        for (std::size_t len = key.size() + 1; len-- != 0; ) {
+            prefix.assign(key, 0, len);
+            if (map.find(prefix) != map.end())
+                return 1;
+        }
+        return 0;
+    }
+    std::size_t prefix_match(const std::string&) { return 0; }
+    std::size_t count_prefix(const std::string&) { return 0; }
+    std::size_t greedy_match(const std::string&) { return 0; }
+    std::size_t range_scan(const std::string&) { return 0; }
+    std::size_t fuzzy_match(const std::string&) { return 0; }
+    std::size_t find_batch(const std::string*, std::size_t) { return 0; }
+    void describe() const { }
+    long iterate() {
+        long sum = 0;
+        for (map_type::iterator it = map.begin(); it != map.end(); ++it)
+            sum += it->second;
+        return sum;
+    }
+};
+
+static std::string random_letters(std::mt19937& rng, int min_len, int max_len)
+{
+    int len = min_len + static_cast<int>(rng() % (max_len - min_len + 1));
+    std::string s;
+
+    for (int i = 0; i < len; ++i)
+        s += static_cast<char>('a' + rng() % 26);
+    return s;
+}
+
+static std::vector<std::string> make_random(std::size_t n, std::mt19937& rng)
+{
+    std::vector<std::string> keys;
+
+    for (std::size_t i = 0; i < n; ++i)
+        keys.push_back(random_letters(rng, 8, 32));
+    return keys;
+}
+
+static std::vector<std::string> make_urls(std::size_t n, std::mt19937& rng)
+{
+    static const char* schemes[] = { "http://", "https://" };
+    static const char* tlds[] = { ".com", ".org", ".net", ".io", ".cn" };
+    static const char* dirs[] = { "static", "api", "v1", "v2", "users", "images", "assets", "docs", "search", "item" };
+    std::vector<std::string> hosts;
+    std::vector<std::string> keys;
+
+    for (int i = 0; i < 300; ++i)
+        hosts.push_back((rng() % 2 ? "www." : "") + random_letters(rng, 4, 12) + tlds[rng() % 5]);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string key = std::string(schemes[rng() % 2]) + hosts[rng() % hosts.size()];
+        int segments = 2 + rng() % 3;
+        for (int s = 0; s < segments; ++s)
+            key += "/" + (s + 1 < segments && rng() % 2 ? std::string(dirs[rng() % 10]) : random_letters(rng, 1, 10));
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+static std::vector<std::string> make_ips(std::size_t n, std::mt19937& rng)
+{
+    std::vector<unsigned> networks;
+    std::vector<std::string> keys;
+
+    for (int i = 0; i < 300; ++i)
+        networks.push_back(rng() & 0xffff0000u);
+    for (std::size_t i = 0; i < n; ++i) {
+        unsigned ip = networks[rng() % networks.size()] | (rng() & 0xffff);
+        keys.push_back(std::to_string(ip >> 24) + "." + std::to_string((ip >> 16) & 255) + "." + std::to_string((ip >> 8) & 255) + "." + std::to_string(ip & 255));
+    }
+    return keys;
+}
+
+static std::vector<std::string> make_words(std::size_t n, std::mt19937& rng, const std::string& file)
+{
+    static const char* onsets[] = { "", "b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r", "s", "t", "v", "st", "tr", "pl", "ch", "sh" };
+    static const char* vowels[] = { "a", "e", "i", "o", "u", "ea", "ou", "io" };
+    static const char* codas[] = { "", "", "n", "r", "s", "t", "l", "m", "nd", "st", "ng" };
+    static const char* suffixes[] = { "", "", "", "s", "ed", "ing", "er", "ly", "ness", "tion" };
+    std::vector<std::string> keys;
+    std::ifstream in(file.c_str());
+    std::string line;
+
+    while (keys.size() < n && std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (!line.empty())
+            keys.push_back(line);
+    }
+    if (!keys.empty())
+        return keys;
+
+    std::printf("# %s not readable, using synthetic words\n", file.c_str());
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string word;
+        int syllables = 1 + rng() % 4;
+        for (int s = 0; s < syllables; ++s)
+            word += std::string(onsets[rng() % 20]) + vowels[rng() % 8] + codas[rng() % 11];
+        keys.push_back(word + suffixes[rng() % 10]);
+    }
+    return keys;
+}
+
+// the keys without duplicates, in random order
+static std::vector<std::string> unique_shuffled(std::vector<std::string> keys, std::mt19937& rng)
+{
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// indices into n keys: uniform, or Zipfian over a random ranking so hot keys are scattered over the key space
+static std::vector<std::size_t> make_accesses(std::size_t n, std::size_t ops, bool zipf, double theta, std::mt19937& rng)
+{
+    std::vector<std::size_t> accesses;
+
+    if (!zipf) {
+        for (std::size_t i = 0; i < ops; ++i)
+            accesses.push_back(rng() % n);
+        return accesses;
+    }
+
+    std::vector<double> cdf(n);
+    double total = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        cdf[i] = total += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+    std::vector<std::size_t> rank(n);
+    for (std::size_t i = 0; i < n; ++i)
+        rank[i] = i;
+    std::shuffle(rank.begin(), rank.end(), rng);
+
+    std::uniform_real_distribution<double> uniform(0, total);
+    for (std::size_t i = 0; i < ops; ++i) {
+        std::size_t r = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        accesses.push_back(rank[r < n ? r : n - 1]);
+    }
+    return accesses;
+}
+
+struct result {
+    double mops;
+    double p50;
+    double p99;
+};
+
+// runs op over the queries untimed for throughput, then once more timing each call
+template<class Op>
+static result measure(const std::vector<std::string>& queries, Op op, long& sink)
+{
+    result r;
+    bench_clock::time_point start = bench_clock::now();
+
+    for (std::size_t i = 0; i < queries.size(); ++i)
+        sink += op(queries[i]);
+    double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    r.mops = queries.size() / seconds / 1e6;
+
+    std::vector<double> ns(queries.size());
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        bench_clock::time_point t = bench_clock::now();
+        sink += op(queries[i]);
+        ns[i] = std::chrono::duration<double, std::nano>(bench_clock::now() - t).count();
+    }
+    std::sort(ns.begin(), ns.end());
+    r.p50 = ns.empty() ? 0 : ns[ns.size() / 2];
+    r.p99 = ns.empty() ? 0 : ns[ns.size() * 99 / 100];
+    return r;
+}
+
+static void report(const char* structure, const char* op, const result& r)
+{
+    std::printf("  %-19s %-14s %9.2f Mops/s %9.0f ns p50 %9.0f ns p99\n", structure, op, r.mops, r.p50, r.p99);
+}
+
+struct workload {
+    std::vector<std::string> keys;
+    std::vector<std::string> find;
+    std::vector<std::string> longest;
+    std::vector<std::string> prefix;
+    std::vector<std::string> greedy;
+};
+
+template<class Adapter>
+static void run(const workload& w, long& sink)
+{
+    const char* name = Adapter::name();
+    std::size_t before = live_bytes();
+    Adapter a;
+
+    // insert and erase change the structure, so their untimed pass runs on a second structure
+    {
+        Adapter untimed;
+        bench_clock::time_point start = bench_clock::now();
+        for (std::size_t i = 0; i < w.keys.size(); ++i)
+            sink += untimed.insert(w.keys[i], static_cast<int>(i));
+        double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+        std::vector<double> ns(w.keys.size());
+        for (std::size_t i = 0; i < w.keys.size(); ++i) {
+            bench_clock::time_point t = bench_clock::now();
+            sink += a.insert(w.keys[i], static_cast<int>(i));
+            ns[i] = std::chrono::duration<double, std::nano>(bench_clock::now() - t).count();
+        }
+        std::sort(ns.begin(), ns.end());
+        result r = { w.keys.size() / seconds / 1e6, ns[ns.size() / 2], ns[ns.size() * 99 / 100] };
+        report(name, "insert", r);
+    }
+    std::size_t bytes = live_bytes() - before;
+
+    report(name, "find", measure(w.find, [&a](const std::string& k) { return a.find(k); }, sink));
+    if (Adapter::supports("find_batch")) {
+        // the find queries in batches of batch_size, throughput only
+        bench_clock::time_point start = bench_clock::now();
+        for (std::size_t i = 0; i < w.find.size(); i += batch_size)
+            sink += a.find_batch(&w.find[i], std::min(batch_size, w.find.size() - i));
+        double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+        std::printf("  %-19s %-14s %9.2f Mops/s\n", name, "find_batch", w.find.size() / seconds / 1e6);
+    }
+    if (Adapter::supports("longest_match"))
+        report(name, "longest_match", measure(w.longest, [&a](const std::string& k) { return a.longest_match(k); }, sink));
+    if (Adapter::supports("prefix_match"))
+        report(name, "prefix_match", measure(w.prefix, [&a](const std::string& k) { return a.prefix_match(k); }, sink));
+    if (Adapter::supports("count_prefix"))
+        report(name, "count_prefix", measure(w.prefix, [&a](const std::string& k) { return a.count_prefix(k); }, sink));
+    if (Adapter::supports("greedy_match"))
+        report(name, "greedy_match", measure(w.greedy, [&a](const std::string& k) { return a.greedy_match(k); }, sink));
+    if (Adapter::supports("range_scan"))
+        report(name, "range_scan", measure(w.greedy, [&a](const std::string& k) { return a.range_scan(k); }, sink));
+    if (Adapter::supports("fuzzy_match"))
+        report(name, "fuzzy_match", measure(w.greedy, [&a](const std::string& k) { return a.fuzzy_match(k); }, sink));
+
+    bench_clock::time_point start = bench_clock::now();
+    sink += a.iterate();
+    double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    std::printf("  %-19s %-14s %9.2f Mkeys/s %8.1f ns/key\n", name, "iterate", w.keys.size() / seconds / 1e6, seconds * 1e9 / w.keys.size());
+    a.describe();
+
+    {
+        Adapter untimed;
+        for (std::size_t i = 0; i < w.keys.size(); ++i)
+            untimed.insert(w.keys[i], static_cast<int>(i));
+        start = bench_clock::now();
+        for (std::size_t i = 0; i < w.keys.size(); ++i)
+            sink += untimed.erase(w.keys[i]);
+        seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+        std::vector<double> ns(w.keys.size());
+        for (std::size_t i = 0; i < w.keys.size(); ++i) {
+            bench_clock::time_point t = bench_clock::now();
+            sink += a.erase(w.keys[i]);
+            ns[i] = std::chrono::duration<double, std::nano>(bench_clock::now() - t).count();
+        }
+        std::sort(ns.begin(), ns.end());
+        result r = { w.keys.size() / seconds / 1e6, ns[ns.size() / 2], ns[ns.size() * 99 / 100] };
+        report(name, "erase", r);
+    }
+
+#if defined(BENCH_HEAP_BYTES)
+    std::printf("  %-19s %-14s %9.1f bytes/key\n", name, "memory", static_cast<double>(bytes) / w.keys.size());
+#else
+    (void)bytes;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    std::string keys_arg = "all", dist_arg = "all", file = "/usr/share/dict/words";
+    std::size_t n = 100000, ops = 200000;
+    double theta = 0.99;
+    unsigned seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt == "--keys")
+            keys_arg = argv[i + 1];
+        else if (opt == "--file")
+            file = argv[i + 1];
+        else if (opt == "--dist")
+            dist_arg = argv[i + 1];
+        else if (opt == "--n")
+            n = std::strtoul(argv[i + 1], NULL, 10);
+        else if (opt == "--ops")
+            ops = std::strtoul(argv[i + 1], NULL, 10);
+        else if (opt == "--theta")
+            theta = std::strtod(argv[i + 1], NULL);
+        else if (opt == "--seed")
+            seed = static_cast<unsigned>(std::strtoul(argv[i + 1], NULL, 10));
+        else {
+            std::fprintf(stderr, "unknown option %s\n", opt.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int i = 0; i < 999; ++i)
+        bench_clock::now();
+    std::printf("# seed %u, %zu keys, %zu operations, clock read %.0f ns\n", seed, n, ops,
+        std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count() / 1000);
+
+    const char* key_sets[] = { "random", "url", "ip", "dict" };
+    const char* dists[] = { "uniform", "zipf" };
+    long sink = 0;
+
+    for (int k = 0; k < 4; ++k) {
+        if (keys_arg != "all" && keys_arg != key_sets[k])
+            continue;
+
+        std::mt19937 rng(seed);
+        std::vector<std::string> raw = k == 0 ? make_random(n, rng) : k == 1 ? make_urls(n, rng) : k == 2 ? make_ips(n, rng) : make_words(n, rng, file);
+        workload w;
+        w.keys = unique_shuffled(raw, rng);
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < w.keys.size(); ++i)
+            bytes += w.keys[i].size();
+
+        for (int d = 0; d < 2; ++d) {
+            if (dist_arg != "all" && dist_arg != dists[d])
+                continue;
+
+            std::vector<std::size_t> accesses = make_accesses(w.keys.size(), ops, d == 1, theta, rng);
+            w.find.clear();
+            w.longest.clear();
+            w.prefix.clear();
+            w.greedy.clear();
+            for (std::size_t i = 0; i < accesses.size(); ++i) {
+                const std::string& key = w.keys[accesses[i]];
+                w.find.push_back(key);
+                w.longest.push_back(key + "/" + random_letters(rng, 1, 4));
+                w.prefix.push_back(key.substr(0, key.size() / 2));
+                std::string greedy = key;
+                greedy[greedy.size() - 1] ^= 1;
+                w.greedy.push_back(greedy);
+            }
+
+            std::printf("%s keys (%zu unique, %.1f bytes average), %s access:\n", key_sets[k], w.keys.size(),
+                static_cast<double>(bytes) / w.keys.size(), dists[d]);
+            run<radix_adapter>(w, sink);
+            run<map_adapter>(w, sink);
+            run<unordered_adapter>(w, sink);
+        }
+    }
+
+    std::printf("# %ld\n", sink);
+    return EXIT_SUCCESS;
+}
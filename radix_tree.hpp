@@ -1,15 +1,32 @@
 #ifndef RADIX_TREE_HPP
 #define RADIX_TREE_HPP
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "radix_tree_it.hpp"
 #include "radix_tree_node.hpp"
+#include "radix_tree_pool.hpp"
+#include "radix_tree_reclaimer.hpp"
+#include "radix_tree_simd.hpp"
+#include "radix_tree_stats.hpp"
 #include <functional>
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define RADIX_TREE_STRING_VIEW
+#endif
+
 template<typename K>
 K radix_substr(const K& key, int begin, int num);
 
@@ -37,21 +54,64 @@ inline int radix_length<std::string>(const std::string& key)
     return static_cast<int>(key.size());
 }
 
+template<typename K>
+const char* radix_data(const K& key);
+
+template<>
+inline const char* radix_data<std::string>(const std::string& key)
+{//ߵıǩֽڴڴУֱֵֽڱȽ
+    return key.data();
+}
+
+#ifdef RADIX_TREE_STRING_VIEW
+//תΪstd::string_viewֲKַͣ绺Ƭȣstring_viewأȹK
+template<typename Key, typename K>
+struct radix_key_view : std::integral_constant<bool,
+    std::is_convertible<const Key&, std::string_view>::value && !std::is_same<Key, K>::value> { };
+#endif
+
+//mergeеļֵʱĴֵ򻻳һֵ
+//ҲԴ(ֵ, һֵ)ãڵһ
+struct radix_merge_keep {
+    template<typename T> void operator()(T&, T&) const { }
+};
+struct radix_merge_replace {
+    template<typename T> void operator()(T& mine, T& theirs) const { mine = std::move(theirs); }
+};
+
+//Ӱߵֵֽǰ޷ֽڵֵУCompareֻstd::less
 template <typename K, typename T, typename Compare>
 class radix_tree {
+    static_assert(std::is_same<Compare, std::less<K> >::value || std::is_same<Compare, std::less<void> >::value,
+        "keys are ordered bytewise, other comparators are not supported");
 public:
     typedef K key_type;
     typedef T mapped_type;
     typedef std::pair<const K, T> value_type;
     typedef radix_tree_it<K, T, Compare>   iterator;
+    typedef radix_tree_it<K, T, Compare, true>   const_iterator;
+    typedef std::reverse_iterator<iterator>   reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
     typedef std::size_t  size_type;
+    typedef radix_tree_range<iterator>   range;
     //캯òбʼԱ ޲
-    radix_tree() : m_size(0), m_root(NULL), m_predicate(Compare()) { }
-    //ֹʽת в
-    explicit radix_tree(Compare pred) : m_size(0), m_root(NULL), m_predicate(pred) { }
-    //
+    radix_tree() : m_size(0), m_root(NULL), m_pool(new radix_tree_pool()), m_owns_pool(true), m_reclaimer(NULL) { }
+    //ֹʽת в죺Compareֻstd::lesspred޲ͬ
+    explicit radix_tree(Compare) : m_size(0), m_root(NULL), m_pool(new radix_tree_pool()), m_owns_pool(true), m_reclaimer(NULL) { }
+    //ʹⲿڴأԹͬһڴأ֤߱ڴرó
+    explicit radix_tree(radix_tree_pool& pool) : m_size(0), m_root(NULL), m_pool(&pool), m_owns_pool(false), m_reclaimer(NULL) {
+        m_counters.allocations = pool.allocations();
+    }
+    //Ӱֵźнbulk_load
+    template<class InputIt>
+    radix_tree(InputIt first, InputIt last) : m_size(0), m_root(NULL), m_pool(new radix_tree_pool()), m_owns_pool(true), m_reclaimer(NULL) {
+        bulk_load(first, last);
+    }
+    //reclaimerʱΪ½ڴ
     ~radix_tree() {
-        delete m_root;
+        release_tree(false);
+        if (m_owns_pool)
+            delete m_pool;
     }
     //m_sizeʾмַ
     size_type size()  const {
@@ -60,489 +120,2020 @@ public:
     bool empty() const {
         return m_size == 0;
     }
-    void clear() {
-        delete m_root;
-        m_root = NULL;
-        m_size = 0;
+    void clear() { release_tree(true); }
+
+    iterator find(const K& key) { return find(radix_data(key), radix_length(key)); }
+    const_iterator find(const K& key) const { return const_cast<radix_tree*>(this)->find(key); }
+    //мֵĽڵ㰴ֵ˳򴮳˫m_listͷҲend()ǰƶֻһ
+    iterator begin() { return iterator(m_list.m_next); }
+    iterator end() { return iterator(&m_list); }
+    const_iterator begin() const { return const_iterator(m_list.m_next); }
+    const_iterator end() const { return const_iterator(const_cast<radix_tree_link*>(&m_list)); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    const_reverse_iterator crend() const { return rend(); }
+    iterator longest_match(const K& key) { return longest_match(radix_data(key), radix_length(key)); }
+
+    //ֵѴʱҲ޸ĴŵֵŵֵֻڴֵĽڵԭعһ
+    std::pair<iterator, bool> insert(const value_type& val) { return insert_key(radix_data(val.first), radix_length(val.first), val); }
+    std::pair<iterator, bool> insert(value_type&& val) { return insert_key(radix_data(val.first), radix_length(val.first), std::move(val)); }
+    //argsֵԲֵֵ֪Ѵʱļֵ
+    template<class... Args> std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type val(std::forward<Args>(args)...);
+        return insert(std::move(val));
     }
-
-    iterator find(const K& key);
-    iterator begin();
-    iterator end();
-    iterator longest_match(const K& key);
-
-    std::pair<iterator, bool> insert(const value_type& val);
-    bool erase(const K& key);
-    void erase(iterator it);
-    void prefix_match(const K& key, std::vector<iterator>& vec);
-    void greedy_match(const K& key, std::vector<iterator>& vec);
-    
-
-    T& operator[] (const K& lhs);
-
-    template<class _UnaryPred> void remove_if(_UnaryPred pred)
-    {
-        radix_tree<K, T, Compare>::iterator backIt;
-        for (radix_tree<K, T, Compare>::iterator it = begin(); it != end(); it = backIt)
-        {
-            backIt = it;
-            backIt++;
-            //ǰָļֵֵtoDelete
-            K toDelete = (*it).first;
-            if (pred(toDelete))
-            {
-                erase(toDelete);
-            }
-        }
+    //ֵʱargsT
+    template<class... Args> std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return insert_key(radix_data(key), radix_length(key), std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    template<class... Args> std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return insert_key(radix_data(key), radix_length(key), std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    //ֵʱֵʱ
+    template<class M> std::pair<iterator, bool> insert_or_assign(const K& key, M&& obj) {
+        std::pair<iterator, bool> ret = try_emplace(key, std::forward<M>(obj));
+        if (!ret.second)
+            ret.first->second = std::forward<M>(obj);
+        return ret;
+    }
+    template<class M> std::pair<iterator, bool> insert_or_assign(K&& key, M&& obj) {
+        std::pair<iterator, bool> ret = try_emplace(std::move(key), std::forward<M>(obj));
+        if (!ret.second)
+            ret.first->second = std::forward<M>(obj);
+        return ret;
+    }
+    bool erase(const K& key) { return erase(radix_data(key), radix_length(key)); }
+    void erase(iterator it) { erase_node(it.node()); }
+    //ɾkeyͷмֵһժ£·ֻһΣɾĸ
+    //ժµڵ߳ͷţreclaimerҲһĽڵڴУڴز̰߳ȫģ
+    //keyΪʱͬclear()
+    size_type erase_prefix(const K& key) { return erase_prefix(radix_data(key), radix_length(key)); }
+    //limitƽĸֻȡǰlimitʱֻЩڵ
+    void prefix_match(const K& key, std::vector<iterator>& vec, size_type limit = size_type(-1)) { prefix_match(radix_data(key), radix_length(key), vec, limit); }
+    void greedy_match(const K& key, std::vector<iterator>& vec, size_type limit = size_type(-1)) { greedy_match(radix_data(key), radix_length(key), vec, limit); }
+    //ƥļֵһΣһε[first, last)ߣԤռ
+    range prefix_range(const K& key) { return prefix_range(radix_data(key), radix_length(key)); }
+    range greedy_range(const K& key) { return greedy_range(radix_data(key), radix_length(key)); }
+    //ֵ˳ÿƥĵvisitvisitfalseʱǰطʹĸ
+    template<class Visitor> size_type for_each_prefix_match(const K& key, Visitor visit) { return visit_range(prefix_range(key), visit); }
+    template<class Visitor> size_type for_each_greedy_match(const K& key, Visitor visit) { return visit_range(greedy_range(key), visit); }
+    //ֵֽڣ޷ţֵУlower_boundصһСkeyļֵupper_boundصһkeyļֵ
+    //ֻkeyһ·Ƚ·ļֵ
+    iterator lower_bound(const K& key) { return lower_bound(radix_data(key), radix_length(key)); }
+    iterator upper_bound(const K& key) { return upper_bound(radix_data(key), radix_length(key)); }
+    const_iterator lower_bound(const K& key) const { return const_cast<radix_tree*>(this)->lower_bound(key); }
+    const_iterator upper_bound(const K& key) const { return const_cast<radix_tree*>(this)->upper_bound(key); }
+    //keyһΣһֵ
+    range equal_range(const K& key) { return equal_range(radix_data(key), radix_length(key)); }
+    //[lo, hi)еļֵloСhiʱΪյһ
+    range bound_range(const K& lo, const K& hi) { return bound_range(radix_data(lo), radix_length(lo), radix_data(hi), radix_length(hi)); }
+    template<class Visitor> size_type for_each_in_range(const K& lo, const K& hi, Visitor visit) { return visit_range(bound_range(lo, hi), visit); }
+    //keyı༭루Levenshteinmax_editsļֵֵ˳visit(, ༭)
+    //visitfalseʱǰطʹĸرߵıǩֽƽһб༭룬жmax_editsʱ
+    template<class Visitor> size_type fuzzy_match(const K& key, int max_edits, Visitor visit) { return fuzzy(radix_data(key), radix_length(key), max_edits, visit, false); }
+    //ͷkeyı༭벻max_editsļֵʱԶȫȡֵǰ׺С
+    template<class Visitor> size_type fuzzy_prefix_match(const K& key, int max_edits, Visitor visit) { return fuzzy(radix_data(key), radix_length(key), max_edits, visit, true); }
+    //keyͷļֵĸСkeyļֵĸֵ˳i0ʼֵiСsize()ʱΪend()ռ
+    //RADIX_TREE_SUBTREE_COUNTSʱÿڵеļֵɾʱ·£ֻһ·ߣ
+    //ÿ࿴һ麢ӣȥ
+    size_type count_prefix(const K& key) const { return count_prefix(radix_data(key), radix_length(key)); }
+    size_type rank(const K& key) const { return rank(radix_data(key), radix_length(key)); }
+    iterator nth(size_type i);
+    const_iterator nth(size_type i) const { return const_cast<radix_tree*>(this)->nth(i); }
+
+    //ֵָͳȸߵıǩֱkey[0, len)Ƚϣ·ϲڴ
+    iterator find(const char* key, int len);
+    iterator longest_match(const char* key, int len);
+    bool erase(const char* key, int len);
+    size_type erase_prefix(const char* key, int len);
+    void prefix_match(const char* key, int len, std::vector<iterator>& vec, size_type limit = size_type(-1));
+    void greedy_match(const char* key, int len, std::vector<iterator>& vec, size_type limit = size_type(-1));
+    range prefix_range(const char* key, int len) { return match_range(key, len, true); }
+    range greedy_range(const char* key, int len) { return match_range(key, len, false); }
+    template<class Visitor> size_type for_each_prefix_match(const char* key, int len, Visitor visit) { return visit_range(prefix_range(key, len), visit); }
+    template<class Visitor> size_type for_each_greedy_match(const char* key, int len, Visitor visit) { return visit_range(greedy_range(key, len), visit); }
+    iterator lower_bound(const char* key, int len) { return bound(key, len, false); }
+    iterator upper_bound(const char* key, int len) { return bound(key, len, true); }
+    range equal_range(const char* key, int len);
+    range bound_range(const char* lo, int len_lo, const char* hi, int len_hi);
+    template<class Visitor> size_type for_each_in_range(const char* lo, int len_lo, const char* hi, int len_hi, Visitor visit) {
+        return visit_range(bound_range(lo, len_lo, hi, len_hi), visit);
+    }
+    template<class Visitor> size_type fuzzy_match(const char* key, int len, int max_edits, Visitor visit) { return fuzzy(key, len, max_edits, visit, false); }
+    template<class Visitor> size_type fuzzy_prefix_match(const char* key, int len, int max_edits, Visitor visit) { return fuzzy(key, len, max_edits, visit, true); }
+    size_type count_prefix(const char* key, int len) const;
+    size_type rank(const char* key, int len) const;
+
+#ifdef RADIX_TREE_STRING_VIEW
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    iterator find(const Key& key) {
+        std::string_view view(key);
+        return find(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    iterator longest_match(const Key& key) {
+        std::string_view view(key);
+        return longest_match(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    bool erase(const Key& key) {
+        std::string_view view(key);
+        return erase(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type erase_prefix(const Key& key) {
+        std::string_view view(key);
+        return erase_prefix(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    void prefix_match(const Key& key, std::vector<iterator>& vec, size_type limit = size_type(-1)) {
+        std::string_view view(key);
+        prefix_match(view.data(), static_cast<int>(view.size()), vec, limit);
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    void greedy_match(const Key& key, std::vector<iterator>& vec, size_type limit = size_type(-1)) {
+        std::string_view view(key);
+        greedy_match(view.data(), static_cast<int>(view.size()), vec, limit);
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    range prefix_range(const Key& key) {
+        std::string_view view(key);
+        return prefix_range(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    range greedy_range(const Key& key) {
+        std::string_view view(key);
+        return greedy_range(view.data(), static_cast<int>(view.size()));
     }
+    template<typename Key, class Visitor, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type for_each_prefix_match(const Key& key, Visitor visit) { return visit_range(prefix_range(key), visit); }
+    template<typename Key, class Visitor, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type for_each_greedy_match(const Key& key, Visitor visit) { return visit_range(greedy_range(key), visit); }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    iterator lower_bound(const Key& key) {
+        std::string_view view(key);
+        return lower_bound(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    iterator upper_bound(const Key& key) {
+        std::string_view view(key);
+        return upper_bound(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    range equal_range(const Key& key) {
+        std::string_view view(key);
+        return equal_range(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    range bound_range(const Key& lo, const Key& hi) {
+        std::string_view view_lo(lo), view_hi(hi);
+        return bound_range(view_lo.data(), static_cast<int>(view_lo.size()), view_hi.data(), static_cast<int>(view_hi.size()));
+    }
+    template<typename Key, class Visitor, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type for_each_in_range(const Key& lo, const Key& hi, Visitor visit) { return visit_range(bound_range(lo, hi), visit); }
+    template<typename Key, class Visitor, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type fuzzy_match(const Key& key, int max_edits, Visitor visit) {
+        std::string_view view(key);
+        return fuzzy(view.data(), static_cast<int>(view.size()), max_edits, visit, false);
+    }
+    template<typename Key, class Visitor, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type fuzzy_prefix_match(const Key& key, int max_edits, Visitor visit) {
+        std::string_view view(key);
+        return fuzzy(view.data(), static_cast<int>(view.size()), max_edits, visit, true);
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type count_prefix(const Key& key) const {
+        std::string_view view(key);
+        return count_prefix(view.data(), static_cast<int>(view.size()));
+    }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    size_type rank(const Key& key) const {
+        std::string_view view(key);
+        return rank(view.data(), static_cast<int>(view.size()));
+    }
+#endif
+
+    //ֵʱֵʼT
+    T& operator[] (const K& lhs) { return try_emplace(lhs).first->second; }
+    T& operator[] (K&& lhs) { return try_emplace(std::move(lhs)).first->second; }
+
+    //ңͬʱƽbatch_windowֵĲңÿһԤȡһҪĽڵ㡢ͱǩ
+    //ֵʱݶѾڻУҵĻȱʧصresults[i]find(keys[i])longest_match(keys[i])ͬ
+    void find_batch(const K* keys, size_type count, iterator* results) { lookup_batch(keys, count, results, false); }
+    void longest_match_batch(const K* keys, size_type count, iterator* results) { lookup_batch(keys, count, results, true); }
+#ifdef RADIX_TREE_STRING_VIEW
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    void find_batch(const Key* keys, size_type count, iterator* results) { lookup_batch(keys, count, results, false); }
+    template<typename Key, typename = typename std::enable_if<radix_key_view<Key, K>::value>::type>
+    void longest_match_batch(const Key* keys, size_type count, iterator* results) { lookup_batch(keys, count, results, true); }
+#endif
+
+    //ðֵźõ滻ݣһɨ裬ڼֵǰ׺ԵϽ
+    //ÿֵӸڵҺͲֽڵ㣬ܵĻֵܳȳȡ
+    //ֻҪֱӴļ룻ظļֵͨ봦ظʱһ
+    //ֵstd::move_iteratorʱֵߣTֻƶ
+    template<class InputIt> void bulk_load(InputIt first, InputIt last);
+    //ͬbulk_loadֵĵһֽڷ飬threads߳и˽еڴؽҵڵϣ
+    //߳׳쳣߳̽õĲֹҵ֮ڵ߳׳
+    template<class RandomIt> void bulk_load_parallel(RandomIt first, RandomIt last, unsigned threads = 0);
+
+    //һнڵ㣬ͳ״ռõڴ
+    radix_tree_stats stats() const;
+    //·ϵļֻжRADIX_TREE_COUNTERSŻ0
+    radix_tree_counters counters() const {
+        radix_tree_counters c = m_counters;
+        c.allocations = m_pool->allocations() - m_counters.allocations;
+        return c;
+    }
+    void reset_counters() {
+        m_counters = radix_tree_counters();
+        m_counters.allocations = m_pool->allocations();
+    }
+    //֮clear()ʱռڴͬеĽڵʹŵֵreclaimerĺ̨߳ͷţ
+    //ֻ߳ժ¸ڵclear()֮һµڴأŵֵһ߳
+    //ʱ䲻ڴdefer׳쳣˻ڵ߳ͷţ׳쳣
+    //NULLʱָڵ߳ͷţʹⲿڴصڵ߳ͷšerase_prefix()ժµ
+    //erase()remove_if()ɾĽڵ㻹ڴУҲڵ߳ͷšreclaimerҪó
+    void set_reclaimer(radix_tree_reclaimer* reclaimer) { m_reclaimer = reclaimer; }
+
+    //otherļֵotherΪֻص·ڵϲǩͼֵ
+    //صùҹеļֵresolveļֵĸ
+    //otherʹԼڴʱӹڴ棻빲һڴҪѽڵƹ
+    template<class Resolve> size_type merge(radix_tree&& other, Resolve resolve);
+    size_type merge(radix_tree&& other) { return merge(std::move(other), radix_merge_keep()); }
+    //prefixͷļֵƵoutУƶĸժ£ٲoutoutеļֵoutֵ
+    //outڴʱƽڵ㣬ڵ߳аѽڵƵoutڴ
+    size_type split(const K& prefix, radix_tree& out) { return split(radix_data(prefix), radix_length(prefix), out); }
+    //ѲСkeyļֵƵoutУƶĸֻkeyһ··ұߵ
+    size_type split_at(const K& key, radix_tree& out) { return split_at(radix_data(key), radix_length(key), out); }
+    size_type split(const char* prefix, int len, radix_tree& out);
+    size_type split_at(const char* key, int len, radix_tree& out);
+
+    //ɾpred(ֵ)Ϊtrueļֵɾĸֵ˳predɾʱ͵
+    //ƼֵҲٴӸڵ²ÿֵ
+    template<class _UnaryPred> size_type remove_if(_UnaryPred pred);
 
 
 private:
     size_type m_size;
     radix_tree_node<K, T, Compare>* m_root;
-    Compare m_predicate;
-
-    radix_tree_node<K, T, Compare>* begin(radix_tree_node<K, T, Compare>* node);
-    radix_tree_node<K, T, Compare>* find_node(const K& key, radix_tree_node<K, T, Compare>* node, int depth);
+    //ڵ㡢ͱߵıǩڴط
+    radix_tree_pool* m_pool;
+    bool m_owns_pool;
+    radix_tree_link m_list;
+    //allocationsǼʼʱڴص
+    radix_tree_counters m_counters;
+    radix_tree_reclaimer* m_reclaimer;
+    //reclaimerһڴءڵʹмֵĽڵ
+    struct teardown {
+        radix_tree_pool* pool;
+        radix_tree_node<K, T, Compare>* root;
+        radix_tree_link list;
+    };
+
+    radix_tree_node<K, T, Compare>* new_node() { return new_node(*m_pool); }
+    radix_tree_node<K, T, Compare>* new_node(radix_tree_pool& pool);
+    //ͷһѾûкӵĽڵ
+    void delete_node(radix_tree_node<K, T, Compare>* node);
+    //ͷrootڵͱǩpool
+    static void delete_tree(radix_tree_pool& pool, radix_tree_node<K, T, Compare>* root);
+    //ͷнڵʹŵֵΪkeep_poolΪfalseʱֻreclaimer½ڴ
+    void release_tree(bool keep_pool);
+    //ѽڵ㡢ֵͬڴؽreclaimerɹʱtrueκһʧܣ䲻ڴ桢defer׳쳣
+    //falseԭɵڵ߳ͷ
+    bool defer_teardown(bool keep_pool);
+    static void reclaim(void* p);
+    //ɾڵϵļֵĸĸڵ
+    void erase_node(radix_tree_node<K, T, Compare>* node);
+    //ֵֻʣһӵĽڵ뺢Ӻϲ
+    void merge_child(radix_tree_node<K, T, Compare>* node);
+    //nodeǸڵ㡢ֵʱûкӾɾֻһӾ뺢Ӻϲ
+    void compress(radix_tree_node<K, T, Compare>* node);
+    //RADIX_TREE_SUBTREE_COUNTSnodeȵֵdeltanodeԼļֵͺnodeֵ
+    //rootнڵֵûжʱʲô
+    static void add_count(radix_tree_node<K, T, Compare>* node, std::ptrdiff_t delta);
+    static void recount(radix_tree_node<K, T, Compare>* node);
+    static void count_subtree(radix_tree_node<K, T, Compare>* root);
+    //nodeһмֵĽڵ
+    radix_tree_node<K, T, Compare>* last_value(radix_tree_node<K, T, Compare>* node) const;
+    //[first, last)ڵժ£succ֮ǰ
+    static void move_run(radix_tree_link* first, radix_tree_link* last, radix_tree_link* succ);
+    //keyͷļֵڵͬϵһƵtoУtoڴأƶĸ
+    size_type detach_prefix(const char* key, int len, radix_tree& to);
+    //Ƶto
+    void move_all(radix_tree& to);
+    //fromеڵ㸴ƵڴУŵֵƹϵλ½ڵ棬ԭĽڵ㻹from
+    radix_tree_node<K, T, Compare>* transplant(radix_tree_node<K, T, Compare>* node, radix_tree_pool& from);
+    //mergeabͬһֵʱϲǣbȵaĩʱba档
+    //bĺworkдңbļֵfrom
+    template<class Resolve>
+    void merge_node(radix_tree_node<K, T, Compare>* a, radix_tree_node<K, T, Compare>* b, Resolve& resolve, size_type& conflicts,
+        std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> >& work);
+    template<class Resolve>
+    void graft(radix_tree_node<K, T, Compare>* a, radix_tree_node<K, T, Compare>* b, Resolve& resolve, size_type& conflicts,
+        std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> >& work);
+    //ϵĽڵŵֵ
+    static void destroy_values(radix_tree_link& list);
+    //keylenֽΪڵıǩ̵ıǩڽڵĸƵڴУԭڴеıǩ黹
+    void set_key(radix_tree_node<K, T, Compare>* node, const char* key, int len) { set_key(*m_pool, node, key, len); }
+    static void set_key(radix_tree_pool& pool, radix_tree_node<K, T, Compare>* node, const char* key, int len) { node->set_label(pool, key, len); }
+    //ڵıǩǷڼֵнڵȵλ
+    bool match_key(const char* key, int len, radix_tree_node<K, T, Compare>* node) const;
+    //ֵ˳node֮һмֵĽڵ㣬û򷵻NULL
+    radix_tree_node<K, T, Compare>* next_value(radix_tree_node<K, T, Compare>* node) const;
+    //nodeеһмֵĽڵ
+    radix_tree_node<K, T, Compare>* first_value(radix_tree_node<K, T, Compare>* node) const;
+    //ֵ˳node֮һмֵĽڵ㣬û򷵻NULL
+    radix_tree_node<K, T, Compare>* skip_subtree(radix_tree_node<K, T, Compare>* node) const;
+    //prefixΪtrueʱֵڵȵĲֱǽڵǩǰ׺򷵻ؿյһ
+    range match_range(const char* key, int len, bool prefix);
+    template<class Visitor> static size_type visit_range(range r, Visitor& visit);
+    //upperΪfalseʱصһСkeyļֵΪtrueʱصһkeyļֵ
+    iterator bound(const char* key, int len, bool upper);
+    template<class Visitor> size_type fuzzy(const char* key, int len, int max_edits, Visitor& visit, bool prefix);
+    //մֵĽڵĺ֮ǰ
+    void link_value(radix_tree_node<K, T, Compare>* node);
+    static void link_before(radix_tree_link* succ, radix_tree_node<K, T, Compare>* node);
+    //ź[first, last)root棬ڵpool䣬мֵĽڵνlistĩβ
+    //ǰһֵļֵŽrejects
+    template<class InputIt>
+    void build_sorted(radix_tree_pool& pool, radix_tree_node<K, T, Compare>* root, radix_tree_link& list,
+        InputIt first, InputIt last, size_type& count, std::vector<value_type>& rejects);
+    radix_tree_node<K, T, Compare>* find_node(const char* key, int len, radix_tree_node<K, T, Compare>* node, int depth);
+    //һֵ״̬nodeǱǩѾȽϹĽڵ㣬childһڵ㣬ǩûбȽ
+    enum { batch_window = 32 };
+    struct batch_lookup {
+        const char* key;
+        int len;
+        int depth;
+        int stage;
+        size_type index;
+        radix_tree_node<K, T, Compare>* node;
+        radix_tree_node<K, T, Compare>* child;
+        radix_tree_node<K, T, Compare>* best;
+    };
+    static void key_bytes(const K& key, const char*& data, int& len) { data = radix_data(key); len = radix_length(key); }
+#ifdef RADIX_TREE_STRING_VIEW
+    template<typename Key>
+    static void key_bytes(const Key& key, const char*& data, int& len) {
+        std::string_view view(key);
+        data = view.data();
+        len = static_cast<int>(view.size());
+    }
+#endif
+    template<typename Key> void lookup_batch(const Key* keys, size_type count, iterator* results, bool longest);
+    //Ѳƽһҽʱtrue
+    bool batch_step(batch_lookup& l);
+    //key[0, len)ʱargsֵԲ
+    template<class... Args> std::pair<iterator, bool> insert_key(const char* key, int len, Args&&... args);
     //ֵ׷ڸĸڵĺ棬Ҷӽڵ
-    radix_tree_node<K, T, Compare>* append(radix_tree_node<K, T, Compare>* parent, const value_type& val);
+    template<class... Args> radix_tree_node<K, T, Compare>* append(radix_tree_node<K, T, Compare>* parent, int len, Args&&... args);
     //ԭڵ㲻ͬĽڵ㣬ڵ㣬󷵻Ҷӽڵ
-    radix_tree_node<K, T, Compare>* prepend(radix_tree_node<K, T, Compare>* node, const value_type& val);
-    void greedy_match(radix_tree_node<K, T, Compare>* node, std::vector<iterator>& vec);
+    template<class... Args> radix_tree_node<K, T, Compare>* prepend(radix_tree_node<K, T, Compare>* node, const char* key, int len, Args&&... args);
     //ƺ͸ֵ
     radix_tree(const radix_tree& other); // delete
     radix_tree& operator =(const radix_tree other); // delete
 };
 
 template <typename K, typename T, typename Compare>
-void radix_tree<K, T, Compare>::prefix_match(const K& key, std::vector<iterator>& vec)
+void radix_tree<K, T, Compare>::prefix_match(const char* key, int len_key, std::vector<iterator>& vec, size_type limit)
 {//ǰ׺ƥ˼ҵ뵱ǰֵͬַҳ
     vec.clear();
-    //ڵΪգǰ׺ƥ
-    if (m_root == NULL)
-        return;
+
+    range r = prefix_range(key, len_key);
+    for (iterator it = r.begin(); it != r.end() && vec.size() < limit; ++it)
+        vec.push_back(it);
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::range radix_tree<K, T, Compare>::match_range(const char* key, int len_key, bool prefix)
+{
+    //ڵΪջûмֵƥ
+    if (m_root == NULL || m_size == 0)
+        return range(end(), end());
 
     radix_tree_node<K, T, Compare>* node;
-    K key_sub1, key_sub2;
     //m_rootڵ㣬Ϊ0ʼҼֵkeyؽڵָnode
-    node = find_node(key, m_root, 0);
-    //ýڵҶӽڵ㣬ڵָ丸ĸڵ
-    if (node->m_is_leaf)
-        node = node->m_parent;
+    node = find_node(key, len_key, m_root, 0);
     //ֵĳ-ڵ
-    int len = radix_length(key) - node->m_depth;
-    //key_sub1ʾֵ಻ͬĲ֣key_sub2ʾnodenode->m_key0ʼlenȵĲ
-    key_sub1 = radix_substr(key, node->m_depth, len);
-    key_sub2 = radix_substr(node->m_key, 0, len);
-    //߲ͬǰ׺أָ̰ƥ䣬Ƿиǰ׺
-    if (key_sub1 != key_sub2)
-        return;
+    int len = len_key - node->m_depth;
+    //ֵĲֱnodeıǩ0ʼlenȵĲ
+    //߲ͬǰ׺ؿյһ
+    if (prefix && (len > node->m_key_len || (len != 0 && !radix_equal(key + node->m_depth, node->label(), len))))
+        return range(end(), end());
+
+    //nodeеļֵϴfirst_value(node)ʼ֮ĵһֵΪֹ
+    radix_tree_node<K, T, Compare>* last = skip_subtree(node);
+
+    return range(iterator(first_value(node)), last != NULL ? iterator(last) : end());
+}
+
+template <typename K, typename T, typename Compare>
+template<class Visitor>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::visit_range(range r, Visitor& visit)
+{
+    size_type count = 0;
+
+    for (iterator it = r.begin(); it != r.end(); ++it) {
+        count++;
+        if (!visit(it))
+            break;
+    }
+
+    return count;
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::bound(const char* key, int len, bool upper)
+{
+    if (m_root == NULL || m_size == 0)
+        return end();
+
+    RADIX_TREE_COUNT(m_counters.lookups);
+    //nodeļֵkey[0, depth)nodeеļֵͷ
+    radix_tree_node<K, T, Compare>* node = m_root;
+    radix_tree_node<K, T, Compare>* found;
+    int depth = 0;
+    for (;;) {
+        if (depth == len) {
+            //еļֵСkeyֻnodeԼļֵkey
+            found = upper && node->m_has_value ? next_value(node) : first_value(node);
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(key[depth]);
+        radix_tree_node<K, T, Compare>* child = node->m_children.find(c);
+        if (child == NULL) {
+            //nodeԼļֵkeyǰ׺keyСһcĺӵkey
+            radix_tree_node<K, T, Compare>* next = node->m_children.next(c);
+            found = next != NULL ? first_value(next) : skip_subtree(node);
+            break;
+        }
+
+        RADIX_TREE_COUNT(m_counters.levels);
+        int len_key = len - depth;
+        int n = child->m_key_len < len_key ? child->m_key_len : len_key;
+        int count = radix_mismatch(key + depth, child->label(), n);
+        if (count < n) {
+            //ǩkeycountֿchildڻСkey
+            if (static_cast<unsigned char>(key[depth + count]) < static_cast<unsigned char>(child->label()[count]))
+                found = first_value(child);
+            else
+                found = skip_subtree(child);
+            break;
+        }
+        if (child->m_key_len > len_key) {
+            //keychildļֵǰ׺
+            found = first_value(child);
+            break;
+        }
+
+        node = child;
+        depth += child->m_key_len;
+    }
+
+    return found != NULL ? iterator(found) : end();
+}
+
+template <typename K, typename T, typename Compare>
+template<class Visitor>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::fuzzy(const char* key, int len, int max_edits, Visitor& visit, bool prefix)
+{
+    if (m_root == NULL || m_size == 0 || max_edits < 0)
+        return 0;
+
+    RADIX_TREE_COUNT(m_counters.lookups);
+    //rowsеd߹dֽkeyÿǰ׺ı༭룬max_editsĶΪlimit
+    //ֻ|j - d| <= max_editsĸӿܲmax_editsÿֻһΣ߸һlimit
+    const int limit = max_edits + 1;
+    const int width = len + 1;
+    std::vector<int> rows(width, limit);
+    //prefixʱbest[d]ǵ0dһСģֵǰdֽиǰ׺keyС
+    std::vector<int> best(1);
+    for (int j = 0; j < width && j < limit; j++)
+        rows[j] = j;
+    best[0] = rows[len];
+
+    //ɵdк͵d + 1ֽd + 1УһСĸӣtailһ
+    auto step = [&](int d, unsigned char c, int& tail) {
+        const int* prev = &rows[static_cast<std::size_t>(d) * width];
+        int* cur = &rows[static_cast<std::size_t>(d + 1) * width];
+        int lo = d + 1 - max_edits > 1 ? d + 1 - max_edits : 1;
+        int hi = d + 1 + max_edits < len ? d + 1 + max_edits : len;
+        int low = cur[0] = d + 1 < limit ? d + 1 : limit;
+        if (lo <= len)
+            cur[lo - 1] = lo - 1 == 0 ? cur[0] : limit;
+        for (int j = lo; j <= hi; j++) {
+            int v = prev[j - 1] + (static_cast<unsigned char>(key[j - 1]) != c);
+            if (prev[j] + 1 < v)
+                v = prev[j] + 1;
+            if (cur[j - 1] + 1 < v)
+                v = cur[j - 1] + 1;
+            cur[j] = v < limit ? v : limit;
+            if (cur[j] < low)
+                low = cur[j];
+        }
+        if (hi + 1 < width)
+            cur[hi + 1] = limit;
+        //һһʱͬmax_edits
+        tail = len >= lo - 1 && len <= hi + 1 ? cur[len] : limit;
+        return low;
+    };
+
+    std::vector<radix_tree_node<K, T, Compare>*> stack;
+    size_type count = 0;
+
+    stack.push_back(m_root);
+    while (!stack.empty()) {
+        radix_tree_node<K, T, Compare>* node = stack.back();
+        stack.pop_back();
+
+        //node->m_depthڸĸڵ㣬nodeıǩֽ
+        int depth = node->m_depth;
+        int stop = depth + node->m_key_len;
+        if (static_cast<int>(best.size()) < stop + 2) {
+            rows.resize(static_cast<std::size_t>(stop + 2) * width, limit);
+            best.resize(stop + 2);
+        }
+        bool alive = true;
+        for (int d = depth; d < stop && alive; d++) {
+            int tail;
+            int low = step(d, static_cast<unsigned char>(node->label()[d - depth]), tail);
+            best[d + 1] = best[d] < tail ? best[d] : tail;
+            if (low > max_edits) {
+                //ֻƥ䣬prefixʱbest[d + 1]ƥ
+                if (prefix && best[d + 1] <= max_edits) {
+                    radix_tree_node<K, T, Compare>* after = skip_subtree(node);
+                    iterator last = after != NULL ? iterator(after) : end();
+                    for (iterator it(first_value(node)); it != last; ++it) {
+                        count++;
+                        if (!visit(it, best[d + 1]))
+                            return count;
+                    }
+                }
+                alive = false;
+            }
+        }
+        if (!alive)
+            continue;
+
+        int distance = prefix ? best[stop] : stop >= len - max_edits && stop <= len + max_edits ? rows[static_cast<std::size_t>(stop) * width + len] : limit;
+        if (node->m_has_value && distance <= max_edits) {
+            count++;
+            if (!visit(iterator(node), distance))
+                return count;
+        }
+
+        //ӱǩĵһֽھںУһУ߲ȥĺӲջҲĽڵ㣻
+        //ջĺԤȡӵĻȱʧص
+        std::size_t top = stack.size();
+        node->m_children.for_each([&](unsigned char c, radix_tree_node<K, T, Compare>* child) {
+            int tail;
+            int low = step(stop, c, tail);
+            if (low <= max_edits || (prefix && (best[stop] <= max_edits || tail <= max_edits))) {
+                radix_prefetch(child);
+                stack.push_back(child);
+            }
+        });
+        //ӵջջʱֵ˳
+        for (std::size_t i = top, j = stack.size(); i + 1 < j; i++, j--)
+            std::swap(stack[i], stack[j - 1]);
+    }
+
+    return count;
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::count_prefix(const char* key, int len_key) const
+{
+    if (m_root == NULL || m_size == 0)
+        return 0;
+
+    //match_rangeֵͬڵȵĲֱǽڵǩǰ׺
+    radix_tree_node<K, T, Compare>* node = const_cast<radix_tree*>(this)->find_node(key, len_key, m_root, 0);
+    int len = len_key - node->m_depth;
+    if (len > node->m_key_len || (len != 0 && !radix_equal(key + node->m_depth, node->label(), len)))
+        return 0;
+
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    return node->m_count;
+#else
+    radix_tree_node<K, T, Compare>* after = skip_subtree(node);
+    const radix_tree_link* last = after != NULL ? static_cast<const radix_tree_link*>(after) : &m_list;
+    size_type count = 0;
+    for (const radix_tree_link* link = first_value(node); link != last; link = link->m_next)
+        count++;
+    return count;
+#endif
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::rank(const char* key, int len) const
+{
+    if (m_root == NULL || m_size == 0)
+        return 0;
+
+    size_type count = 0;
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    //keyߣ·ϽڵԼļֵkeyǰ׺Сkey[depth]ĺСkey
+    radix_tree_node<K, T, Compare>* node = m_root;
+    int depth = 0;
+    while (depth != len) {
+        if (node->m_has_value)
+            count++;
+
+        unsigned char c = static_cast<unsigned char>(key[depth]);
+        radix_tree_node<K, T, Compare>* child = NULL;
+        node->m_children.for_each([&count, &child, c](unsigned char edge, radix_tree_node<K, T, Compare>* n) {
+            if (edge < c)
+                count += n->m_count;
+            else if (edge == c)
+                child = n;
+        });
+        if (child == NULL)
+            break;
+
+        int len_key = len - depth;
+        int n = child->m_key_len < len_key ? child->m_key_len : len_key;
+        int count_eq = radix_mismatch(key + depth, child->label(), n);
+        if (count_eq < n) {
+            //ǩkeyмֿǩСʱСkey
+            if (static_cast<unsigned char>(child->label()[count_eq]) < static_cast<unsigned char>(key[depth + count_eq]))
+                count += child->m_count;
+            break;
+        }
+        //keyڱǩмʱchildkey
+        if (child->m_key_len > len_key)
+            break;
 
-    greedy_match(node, vec);
+        node = child;
+        depth += child->m_key_len;
+    }
+#else
+    radix_tree* self = const_cast<radix_tree*>(this);
+    iterator last = self->lower_bound(key, len);
+    for (iterator it = self->begin(); it != last; ++it)
+        count++;
+#endif
+
+    return count;
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::nth(size_type i)
+{
+    if (i >= m_size)
+        return end();
+
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    //ڵԼļֵں֮ǰٰӵ˳ֱiֵĳӵ
+    radix_tree_node<K, T, Compare>* node = m_root;
+    for (;;) {
+        if (node->m_has_value) {
+            if (i == 0)
+                return iterator(node);
+            i--;
+        }
+
+        radix_tree_node<K, T, Compare>* child = node->m_children.first();
+        while (i >= child->m_count) {
+            i -= child->m_count;
+            child = node->m_children.next(child->edge());
+        }
+        node = child;
+    }
+#else
+    iterator it = begin();
+    for (; i != 0; i--)
+        ++it;
+    return it;
+#endif
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::range radix_tree<K, T, Compare>::equal_range(const char* key, int len)
+{
+    iterator first = lower_bound(key, len);
+    iterator last = first;
+
+    //һСkeyļֵֻkeyʱһ
+    if (first != end() && radix_length(first->first) == len && radix_equal(radix_data(first->first), key, len))
+        ++last;
+
+    return range(first, last);
 }
 
 template <typename K, typename T, typename Compare>
-typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::longest_match(const K& key)
+typename radix_tree<K, T, Compare>::range radix_tree<K, T, Compare>::bound_range(const char* lo, int len_lo, const char* hi, int len_hi)
+{
+    //ȱȽlohiloСhiʱhiλÿlo֮ǰΪһεĽβ
+    int n = len_lo < len_hi ? len_lo : len_hi;
+    int count = radix_mismatch(lo, hi, n);
+    bool less = count < n ? static_cast<unsigned char>(lo[count]) < static_cast<unsigned char>(hi[count]) : len_lo < len_hi;
+
+    if (!less)
+        return range(end(), end());
+
+    return range(lower_bound(lo, len_lo), lower_bound(hi, len_hi));
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::longest_match(const char* key, int len)
 {//ƥ˼ҵ뵱ǰڵ㾡ܶģַͬǰ׺ַҶ
     if (m_root == NULL)
-        return iterator(NULL);
+        return end();
 
     radix_tree_node<K, T, Compare>* node;
-    K key_sub;
-
-    node = find_node(key, m_root, 0);
 
-    if (node->m_is_leaf)
-        return iterator(node);
+    node = find_node(key, len, m_root, 0);
 
-    key_sub = radix_substr(key, node->m_depth, radix_length(node->m_key));
     //Ⱦͻݵĸڵ
-    if (!(key_sub == node->m_key))
+    if (!match_key(key, len, node))
         node = node->m_parent;
 
-    K nul = radix_substr(key, 0, 0);
-
     while (node != NULL) {
-        typename radix_tree_node<K, T, Compare>::it_child it;
-        it = node->m_children.find(nul);
-        //ҵҶӽڵ㣬򷵻
-        if (it != node->m_children.end() && it->second->m_is_leaf)
-            return iterator(it->second);
+        //ýڵмֵ򷵻
+        if (node->m_has_value)
+            return iterator(node);
         //ϻ
         node = node->m_parent;
     }
 
-    return iterator(NULL);
+    return end();
 }
 
 
+
 template <typename K, typename T, typename Compare>
-typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::end()
+template<typename Key>
+void radix_tree<K, T, Compare>::lookup_batch(const Key* keys, size_type count, iterator* results, bool longest)
 {
-    return iterator(NULL);
+    if (m_root == NULL) {
+        for (size_type i = 0; i < count; i++)
+            results[i] = end();
+        return;
+    }
+
+    batch_lookup window[batch_window];
+    int active = 0;
+    size_type next = 0;
+
+    for (;;) {
+        //ճλһֵ
+        while (active < batch_window && next < count) {
+            batch_lookup& l = window[active];
+            key_bytes(keys[next], l.key, l.len);
+            l.index = next++;
+            //ֵֽҲڱ𴦣ǰһԤȡ
+            if (next + batch_window < count) {
+                const char* ahead;
+                int ahead_len;
+                key_bytes(keys[next + batch_window], ahead, ahead_len);
+                radix_prefetch(ahead);
+            }
+            l.node = m_root;
+            l.child = NULL;
+            l.best = m_root->m_has_value ? m_root : NULL;
+            l.depth = 0;
+            l.stage = 0;
+            RADIX_TREE_COUNT(m_counters.lookups);
+            if (l.len == 0) {
+                results[l.index] = m_root->m_has_value ? iterator(m_root) : end();
+                continue;
+            }
+            m_root->m_children.prefetch(static_cast<unsigned char>(l.key[0]));
+            active++;
+        }
+        if (active == 0)
+            break;
+
+        for (int j = 0; j < active; ) {
+            batch_lookup& l = window[j];
+            if (!batch_step(l)) {
+                j++;
+                continue;
+            }
+            //ǩȽϹĽڵ㶼Ǽֵǰ׺Ĵмֵһǳƥ
+            if (longest)
+                results[l.index] = l.best != NULL ? iterator(l.best) : end();
+            else
+                results[l.index] = l.node->m_has_value && l.depth == l.len ? iterator(l.node) : end();
+            l = window[--active];
+        }
+    }
 }
 
 template <typename K, typename T, typename Compare>
-typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::begin()
+bool radix_tree<K, T, Compare>::batch_step(batch_lookup& l)
 {
-    radix_tree_node<K, T, Compare>* node;
+    switch (l.stage) {
+    case 0:
+        //ѾԤȡҵӺԤȡӽڵ
+        l.child = l.node->m_children.find(static_cast<unsigned char>(l.key[l.depth]));
+        if (l.child == NULL)
+            return true;
+        RADIX_TREE_COUNT(m_counters.levels);
+        radix_prefetch(l.child);
+        l.stage = 1;
+        return false;
+    case 1:
+        //ӽڵѾԤȡıǩһҪĺ
+        radix_prefetch(l.child->label());
+        if (l.child->m_key_len < l.len - l.depth)
+            l.child->m_children.prefetch(static_cast<unsigned char>(l.key[l.depth + l.child->m_key_len]));
+        l.stage = 2;
+        return false;
+    default:
+        if (l.child->m_key_len > l.len - l.depth || !radix_equal(l.key + l.depth, l.child->label(), l.child->m_key_len))
+            return true;
+        l.node = l.child;
+        l.depth += l.child->m_key_len;
+        if (l.node->m_has_value)
+            l.best = l.node;
+        l.stage = 0;
+        return l.depth == l.len;
+    }
+}
 
-    if (m_root == NULL || m_size == 0)
-        node = NULL;
-    else
-        node = begin(m_root);
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::greedy_match(const char* key, int len, std::vector<iterator>& vec, size_type limit)
+{//ҵ뵱ǰֵͬĹǰ׺ַ
+    vec.clear();
 
-    return iterator(node);
+    range r = greedy_range(key, len);
+    for (iterator it = r.begin(); it != r.end() && vec.size() < limit; ++it)
+        vec.push_back(it);
 }
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::begin(radix_tree_node<K, T, Compare>* node)
+template<class InputIt>
+void radix_tree<K, T, Compare>::bulk_load(InputIt first, InputIt last)
 {
-    if (node->m_is_leaf)
-        return node;
+    std::vector<value_type> rejects;
 
+    clear();
+    m_root = new_node();
+    build_sorted(*m_pool, m_root, m_list, first, last, m_size, rejects);
+    count_subtree(m_root);
 
-    assert(!node->m_children.empty());
-
-    return begin(node->m_children.begin()->second);
+    for (std::size_t i = 0; i < rejects.size(); i++)
+        insert(std::move(rejects[i]));
 }
 
 template <typename K, typename T, typename Compare>
-T& radix_tree<K, T, Compare>::operator[] (const K& lhs)
+template<class RandomIt>
+void radix_tree<K, T, Compare>::bulk_load_parallel(RandomIt first, RandomIt last, unsigned threads)
 {
-    iterator it = find(lhs);
-    //ûиüֵ
-    if (it == end()) {
-        std::pair<K, T> val;
-        val.first = lhs;
+    //ͬһһֽڵļֵźһΣεཻ
+    struct group {
+        RandomIt first, last;
+        radix_tree_link list;
+        radix_tree_node<K, T, Compare>* subtree;
+        size_type count;
+        std::vector<value_type> rejects;
+    };
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+
+    std::vector<value_type> rejects;
+    std::exception_ptr error;
+
+    clear();
+    m_root = new_node();
+
+    //ռֵڸڵϣڵǰ̴߳
+    RandomIt begin = first;
+    while (begin != last && radix_length(begin->first) == 0)
+        ++begin;
+    build_sorted(*m_pool, m_root, m_list, first, begin, m_size, rejects);
+
+    std::vector<std::pair<RandomIt, RandomIt> > runs;
+    int last_byte = -1;
+    for (RandomIt it = begin; it != last; ) {
+        RandomIt run = it;
+        int byte = static_cast<unsigned char>(radix_data(it->first)[0]);
+        while (it != last && radix_length(it->first) != 0 && static_cast<unsigned char>(radix_data(it->first)[0]) == byte)
+            ++it;
+        if (run == it) {
+            //Ŀռֵ
+            rejects.emplace_back(*it);
+            ++it;
+        }
+        else if (byte <= last_byte) {
+            //һεĵһֽѾֹ
+            for (; run != it; ++run)
+                rejects.emplace_back(*run);
+        }
+        else {
+            runs.push_back(std::make_pair(run, it));
+            last_byte = byte;
+        }
+    }
 
-        std::pair<iterator, bool> ret;
-        //üֵλ
-        ret = insert(val);
+    if (threads > runs.size())
+        threads = static_cast<unsigned>(runs.size());
 
-        assert(ret.second == true);
+    if (threads <= 1) {
+        build_sorted(*m_pool, m_root, m_list, begin, last, m_size, rejects);
+    }
+    else {
+        std::unique_ptr<group[]> groups(new group[runs.size()]);
+        std::vector<std::unique_ptr<radix_tree_pool> > pools;
+        std::vector<std::thread> workers;
+        //쳣뿪std::thread̰߳Լ쳣
+        std::vector<std::exception_ptr> errors(threads);
+        std::atomic<std::size_t> next(0);
+
+        for (std::size_t i = 0; i < runs.size(); i++) {
+            groups[i].first = runs[i].first;
+            groups[i].last = runs[i].second;
+            groups[i].subtree = NULL;
+            groups[i].count = 0;
+        }
+        for (unsigned t = 0; t < threads; t++)
+            pools.push_back(std::unique_ptr<radix_tree_pool>(new radix_tree_pool(m_pool->chunk_size())));
+
+        for (unsigned t = 0; t < threads; t++) {
+            radix_tree_pool* pool = pools[t].get();
+            workers.push_back(std::thread([this, pool, t, &groups, &runs, &next, &errors]() {
+                for (std::size_t i; (i = next++) < runs.size(); ) {
+                    //ʱĸڵ½ͬһļֵһֽͬʱڵֻһ
+                    group& g = groups[i];
+                    radix_tree_node<K, T, Compare> root;
+                    try {
+                        build_sorted(*pool, &root, g.list, g.first, g.last, g.count, g.rejects);
+                    }
+                    catch (...) {
+                        //ѾõĲҵϣ鶼ٴ
+                        errors[t] = std::current_exception();
+                        next = runs.size();
+                    }
+                    g.subtree = root.m_children.first();
+                    if (g.subtree != NULL)
+                        root.m_children.erase(g.subtree->edge(), *pool);
+                }
+            }));
+        }
+        for (unsigned t = 0; t < threads; t++) {
+            workers[t].join();
+            if (!error)
+                error = errors[t];
+        }
 
-        it = ret.first;
+        for (std::size_t i = 0; i < runs.size(); i++) {
+            group& g = groups[i];
+            if (g.subtree == NULL)
+                continue;
+            g.subtree->m_parent = m_root;
+            m_root->m_children.insert(g.subtree->edge(), g.subtree, *m_pool);
+            //һֽڵ˳ӵĩβ
+            g.list.m_next->m_prev = m_list.m_prev;
+            m_list.m_prev->m_next = g.list.m_next;
+            g.list.m_prev->m_next = &m_list;
+            m_list.m_prev = g.list.m_prev;
+            m_size += g.count;
+            for (std::size_t j = 0; j < g.rejects.size(); j++)
+                rejects.push_back(std::move(g.rejects[j]));
+        }
+        for (unsigned t = 0; t < threads; t++)
+            m_pool->merge(*pools[t]);
     }
+    count_subtree(m_root);
 
-    return it->second;
+    //ͬbulk_load;쳣ʹļֵٲ
+    if (error)
+        std::rethrow_exception(error);
+
+    for (std::size_t i = 0; i < rejects.size(); i++)
+        insert(std::move(rejects[i]));
 }
 
 template <typename K, typename T, typename Compare>
-void radix_tree<K, T, Compare>::greedy_match(const K& key, std::vector<iterator>& vec)
-{//ҵ뵱ǰֵͬĹǰ׺ַ
-    radix_tree_node<K, T, Compare>* node;
+template<class InputIt>
+void radix_tree<K, T, Compare>::build_sorted(radix_tree_pool& pool, radix_tree_node<K, T, Compare>* root, radix_tree_link& list,
+    InputIt first, InputIt last, size_type& count, std::vector<value_type>& rejects)
+{
+    //pathұߵһ·µļֵֻ·
+    std::vector<radix_tree_node<K, T, Compare>*> path;
+    const char* prev = NULL;
+    int prev_len = -1;
+
+    path.push_back(root);
+
+    //ֵʱֵߣŽrejects
+    typedef typename std::iterator_traits<InputIt>::reference reference;
+
+    for (; first != last; ++first) {
+        reference val = *first;
+        const char* key = radix_data(val.first);
+        int len = radix_length(val.first);
+        int lcp = 0;
+
+        if (prev_len >= 0) {
+            //ǰһֵǰ׺
+            lcp = radix_mismatch(prev, key, prev_len < len ? prev_len : len);
+            //ظ߱ǰһֵС
+            if (lcp == len || (lcp < prev_len && static_cast<unsigned char>(key[lcp]) < static_cast<unsigned char>(prev[lcp]))) {
+                rejects.emplace_back(std::forward<reference>(val));
+                continue;
+            }
+        }
 
-    vec.clear();
-    //ڵΪգͷ
+        //˻صǩڹǰ׺֮ڵĽڵ
+        radix_tree_node<K, T, Compare>* child = NULL;
+        while (path.back()->m_depth + path.back()->m_key_len > lcp) {
+            child = path.back();
+            path.pop_back();
+        }
+
+        radix_tree_node<K, T, Compare>* parent = path.back();
+
+        if (parent->m_depth + parent->m_key_len < lcp) {
+            //ǰ׺childıǩмchild
+            int split = lcp - child->m_depth;
+            radix_tree_node<K, T, Compare>* node_a = new_node(pool);
+
+            node_a->m_parent = parent;
+            node_a->m_depth = child->m_depth;
+            set_key(pool, node_a, child->label(), split);
+            //node_aıǩchildĵһֱֽͬռchildλ
+            parent->m_children.insert(node_a->edge(), node_a, pool);
+
+            child->m_parent = node_a;
+            child->m_depth = lcp;
+            set_key(pool, child, child->label() + split, child->m_key_len - split);
+            node_a->m_children.insert(child->edge(), child, pool);
+
+            path.push_back(node_a);
+            parent = node_a;
+        }
+
+        radix_tree_node<K, T, Compare>* node;
+
+        if (len == lcp) {
+            //ֻеһֵǿռֵʱŻڸڵ
+            parent->set_value(std::forward<reference>(val));
+            node = parent;
+        }
+        else {
+            node = new_node(pool);
+            node->m_parent = parent;
+            node->m_depth = lcp;
+            set_key(pool, node, key + lcp, len - lcp);
+            //keyָеļֵ֮ǰȸƺñǩ
+            node->set_value(std::forward<reference>(val));
+            parent->m_children.insert(node->edge(), node, pool);
+            path.push_back(node);
+        }
+
+        link_before(&list, node);
+        count++;
+
+        prev = radix_data(node->m_value.first);
+        prev_len = len;
+    }
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_stats radix_tree<K, T, Compare>::stats() const
+{
+    radix_tree_stats st;
+
+    st.values = m_size;
+    st.pool_bytes = m_pool->bytes_reserved();
+
+    //ջݹ飬Ҳջջǽڵڸڵ֮µĲ
+    std::vector<std::pair<const radix_tree_node<K, T, Compare>*, std::size_t> > stack;
+    if (m_root != NULL)
+        stack.push_back(std::make_pair(m_root, std::size_t(0)));
+
+    while (!stack.empty()) {
+        const radix_tree_node<K, T, Compare>* node = stack.back().first;
+        std::size_t level = stack.back().second;
+        stack.pop_back();
+
+        st.nodes++;
+        if (st.depths.size() <= level)
+            st.depths.resize(level + 1, 0);
+        st.depths[level]++;
+        st.fanout[node->m_children.size()]++;
+        if (node->m_children.empty())
+            st.leaves++;
+        if (node != m_root)
+            st.label_lengths[node->m_key_len < radix_tree_stats::max_label_length ? node->m_key_len : radix_tree_stats::max_label_length]++;
+        st.node_bytes += sizeof(radix_tree_node<K, T, Compare>);
+        st.child_bytes += node->m_children.bytes();
+        if (node->m_key_len > radix_tree_node<K, T, Compare>::inline_label) {
+            st.label_bytes += m_pool->block_size(node->m_key_len);
+            st.label_arena_bytes += node->m_key_len;
+        }
+        else if (node != m_root)
+            st.inline_labels++;
+
+        for (const radix_tree_node<K, T, Compare>* child = node->m_children.first(); child != NULL; child = node->m_children.next(child->edge()))
+            stack.push_back(std::make_pair(child, level + 1));
+    }
+
+    st.heap_bytes = m_owns_pool && m_pool->slabs() ? st.pool_bytes : st.node_bytes + st.child_bytes + st.label_bytes;
+
+    return st;
+}
+
+template <typename K, typename T, typename Compare>
+bool radix_tree<K, T, Compare>::erase(const char* key, int len)
+{
     if (m_root == NULL)
-        return;
-    
-    node = find_node(key, m_root, 0);
-    //
-    if (node->m_is_leaf)
-        node = node->m_parent;
+        return 0;
+
+    radix_tree_node<K, T, Compare>* child;
+
+    child = find_node(key, len, m_root, 0);
 
-    greedy_match(node, vec);
+    if (!child->m_has_value || child->m_depth + child->m_key_len != len || !match_key(key, len, child))
+        return 0;
+
+    erase_node(child);
+
+    return 1;
 }
 
 template <typename K, typename T, typename Compare>
-void radix_tree<K, T, Compare>::greedy_match(radix_tree_node<K, T, Compare>* node, std::vector<iterator>& vec)
+void radix_tree<K, T, Compare>::erase_node(radix_tree_node<K, T, Compare>* child)
 {
-    //ҵҶӽڵ㣬˵÷֧йǰ׺ģҶӽڵ㣬Ҷӽڵ
-    if (node->m_is_leaf) {
-        vec.push_back(iterator(node));
+    radix_tree_node<K, T, Compare>* parent;
+
+    child->m_prev->m_next = child->m_next;
+    child->m_next->m_prev = child->m_prev;
+    child->clear_value();
+    add_count(child, -1);
+
+    m_size--;
+    RADIX_TREE_COUNT(m_counters.erases);
+
+    if (child == m_root)
         return;
-    }
 
-    typename std::map<K, radix_tree_node<K, T, Compare>*>::iterator it;
-    //еĺ
-    for (it = node->m_children.begin(); it != node->m_children.end(); ++it) {
-        greedy_match(it->second, vec);
+    if (child->m_children.size() > 1)
+        return;
+
+    if (child->m_children.empty()) {
+        parent = child->m_parent;
+        parent->m_children.erase(child->edge(), *m_pool);
+        delete_node(child);
+
+        if (parent == m_root || parent->m_has_value || parent->m_children.size() != 1)
+            return;
+    }
+    else {
+        parent = child;
     }
+
+    //parentûֵֻһӣӺϲ
+    merge_child(parent);
 }
 
 template <typename K, typename T, typename Compare>
-void radix_tree<K, T, Compare>::erase(iterator it)
+void radix_tree<K, T, Compare>::merge_child(radix_tree_node<K, T, Compare>* parent)
 {
-    erase(it->first);
+    RADIX_TREE_COUNT(m_counters.merges);
+    radix_tree_node<K, T, Compare>* uncle = parent->m_children.first();
+
+    parent->m_children.erase(uncle->edge(), *m_pool);
+
+    uncle->set_label(*m_pool, parent->label(), parent->m_key_len, uncle->label(), uncle->m_key_len);
+    uncle->m_depth = parent->m_depth;
+    uncle->m_parent = parent->m_parent;
+
+    //ϲıǩparentֽڿͷuncleparent游ڵеλ
+    parent->m_parent->m_children.insert(uncle->edge(), uncle, *m_pool);
+
+    delete_node(parent);
 }
 
 template <typename K, typename T, typename Compare>
-bool radix_tree<K, T, Compare>::erase(const K& key)
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::erase_prefix(const char* key, int len_key)
 {
-    if (m_root == NULL)
-        return 0;
+    if (len_key == 0) {
+        size_type count = m_size;
+        clear();
+        return count;
+    }
 
-    radix_tree_node<K, T, Compare>* child;
-    radix_tree_node<K, T, Compare>* parent;
-    radix_tree_node<K, T, Compare>* grandparent;
-    K nul = radix_substr(key, 0, 0);
+    //ժڴصʱУʱڵ߳ͷţreclaimer
+    radix_tree<K, T, Compare> detached(*m_pool);
 
-    child = find_node(key, m_root, 0);
+    return detach_prefix(key, len_key, detached);
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::detach_prefix(const char* key, int len_key, radix_tree& to)
+{
+    assert(to.m_root == NULL && to.m_pool == m_pool);
 
-    if (!child->m_is_leaf)
+    if (m_root == NULL || m_size == 0)
         return 0;
 
-    parent = child->m_parent;
-    parent->m_children.erase(nul);
+    radix_tree_node<K, T, Compare>* node = find_node(key, len_key, m_root, 0);
+    //match_rangeֵͬڵȵĲֱǽڵǩǰ׺
+    int len = len_key - node->m_depth;
+    if (len > node->m_key_len || (len != 0 && !radix_equal(key + node->m_depth, node->label(), len)))
+        return 0;
 
-    delete child;
+    if (node == m_root) {
+        size_type count = m_size;
+        move_all(to);
+        return count;
+    }
 
-    m_size--;
+    //еļֵһΣժ
+    radix_tree_node<K, T, Compare>* first = first_value(node);
+    radix_tree_node<K, T, Compare>* after = skip_subtree(node);
+    radix_tree_link* last = after != NULL ? static_cast<radix_tree_link*>(after) : &m_list;
+    size_type count = 0;
+    for (radix_tree_link* link = first; link != last; link = link->m_next)
+        count++;
+    move_run(first, last, &to.m_list);
+    m_size -= count;
+    to.m_size = count;
+
+    //ӸĸڵժºֻиĸڵҪʣµΨһӺϲ
+    radix_tree_node<K, T, Compare>* parent = node->m_parent;
+    add_count(parent, -static_cast<std::ptrdiff_t>(count));
+    parent->m_children.erase(node->edge(), *m_pool);
+    compress(parent);
+
+    //ĸڵҵtoĸڵ£ǩɴ0ʼֵĽڵȲ
+    to.m_root = to.new_node();
+    set_key(node, radix_data(first->m_value.first), node->m_depth + node->m_key_len);
+    node->m_depth = 0;
+    node->m_parent = to.m_root;
+    to.m_root->m_children.insert(node->edge(), node, *m_pool);
+    recount(to.m_root);
+
+    return count;
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::move_all(radix_tree& to)
+{
+    assert(to.m_root == NULL && to.m_pool == m_pool);
+
+    to.m_root = m_root;
+    to.m_size = m_size;
+    if (m_list.m_next != &m_list)
+        move_run(m_list.m_next, &m_list, &to.m_list);
+    m_root = NULL;
+    m_size = 0;
+}
 
-    if (parent == m_root)
-        return 1;
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::move_run(radix_tree_link* first, radix_tree_link* last, radix_tree_link* succ)
+{
+    radix_tree_link* back = last->m_prev;
+
+    first->m_prev->m_next = last;
+    last->m_prev = first->m_prev;
+
+    first->m_prev = succ->m_prev;
+    back->m_next = succ;
+    succ->m_prev->m_next = first;
+    succ->m_prev = back;
+}
 
-    if (parent->m_children.size() > 1)
-        return 1;
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::compress(radix_tree_node<K, T, Compare>* node)
+{
+    if (node == m_root || node->m_has_value || node->m_children.size() > 1)
+        return;
 
-    if (parent->m_children.empty()) {
-        grandparent = parent->m_parent;
-        grandparent->m_children.erase(parent->m_key);
-        delete parent;
+    if (node->m_children.empty()) {
+        node->m_parent->m_children.erase(node->edge(), *m_pool);
+        delete_node(node);
     }
     else {
-        grandparent = parent;
+        merge_child(node);
+    }
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::add_count(radix_tree_node<K, T, Compare>* node, std::ptrdiff_t delta)
+{
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    //޷ļӷڻƺõͬĽ
+    for (; node != NULL; node = node->m_parent)
+        node->m_count += static_cast<std::size_t>(delta);
+#else
+    (void)node;
+    (void)delta;
+#endif
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::recount(radix_tree_node<K, T, Compare>* node)
+{
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    std::size_t count = node->m_has_value ? 1 : 0;
+    node->m_children.for_each([&count](unsigned char, radix_tree_node<K, T, Compare>* child) { count += child->m_count; });
+    node->m_count = count;
+#else
+    (void)node;
+#endif
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::count_subtree(radix_tree_node<K, T, Compare>* root)
+{
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    //źнڵ㣬ʱÿڵ㶼ĺ֮󣬺ӵļֵѾ
+    std::vector<radix_tree_node<K, T, Compare>*> order(1, root);
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i]->m_children.for_each([&order](unsigned char, radix_tree_node<K, T, Compare>* child) { order.push_back(child); });
+    for (std::size_t i = order.size(); i-- != 0; )
+        recount(order[i]);
+#else
+    (void)root;
+#endif
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::last_value(radix_tree_node<K, T, Compare>* node) const
+{
+    //ĽڵһµҶӣҶһмֵ
+    while (!node->m_children.empty())
+        node = node->m_children.last();
+
+    return node;
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::split(const char* prefix, int len, radix_tree& out)
+{
+    assert(&out != this);
+
+    radix_tree<K, T, Compare> detached(*m_pool);
+    size_type count = detach_prefix(prefix, len, detached);
+    if (count != 0)
+        out.merge(std::move(detached));
+
+    return count;
+}
+
+template <typename K, typename T, typename Compare>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::split_at(const char* key, int len, radix_tree& out)
+{
+    assert(&out != this);
+
+    iterator first = lower_bound(key, len);
+    if (first == end())
+        return 0;
+
+    radix_tree<K, T, Compare> detached(*m_pool);
+    size_type count = 0;
+    if (first == begin()) {
+        count = m_size;
+        move_all(detached);
+        out.merge(std::move(detached));
+        return count;
     }
 
-    if (grandparent == m_root) {
-        return 1;
+    //ߵļֵfirstʼβ
+    for (radix_tree_link* link = first.m_pointee; link != &m_list; link = link->m_next)
+        count++;
+    move_run(first.m_pointee, &m_list, &detached.m_list);
+    m_size -= count;
+    detached.m_size = count;
+
+    //xkeyߣydetachedдͬһֵĽڵ㣻xвСkeyĲƵy
+    detached.m_root = detached.new_node();
+    radix_tree_node<K, T, Compare>* x = m_root;
+    radix_tree_node<K, T, Compare>* y = detached.m_root;
+    std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> > path;
+    int depth = 0;
+    for (;;) {
+        if (depth == len) {
+            //xļֵkeyxļֵߣyϽx
+            if (x->m_has_value) {
+                y->set_value(std::move(x->m_value));
+                y->m_prev = x->m_prev;
+                y->m_next = x->m_next;
+                y->m_prev->m_next = y;
+                y->m_next->m_prev = y;
+                x->clear_value();
+            }
+            while (radix_tree_node<K, T, Compare>* child = x->m_children.first()) {
+                x->m_children.erase(child->edge(), *m_pool);
+                child->m_parent = y;
+                y->m_children.insert(child->edge(), child, *m_pool);
+            }
+            break;
+        }
+
+        //xԼļֵkeyǰ׺£ߴkey[depth]ĺ
+        unsigned char c = static_cast<unsigned char>(key[depth]);
+        while (radix_tree_node<K, T, Compare>* child = x->m_children.next(c)) {
+            x->m_children.erase(child->edge(), *m_pool);
+            child->m_parent = y;
+            y->m_children.insert(child->edge(), child, *m_pool);
+        }
+
+        radix_tree_node<K, T, Compare>* child = x->m_children.find(c);
+        if (child == NULL)
+            break;
+        int len_key = len - depth;
+        int n = child->m_key_len < len_key ? child->m_key_len : len_key;
+        int count_eq = radix_mismatch(key + depth, child->label(), n);
+        bool greater = count_eq < n ? static_cast<unsigned char>(key[depth + count_eq]) < static_cast<unsigned char>(child->label()[count_eq])
+            : child->m_key_len > len_key;
+        if (greater) {
+            x->m_children.erase(c, *m_pool);
+            child->m_parent = y;
+            y->m_children.insert(c, child, *m_pool);
+            break;
+        }
+        if (count_eq < n)
+            break;
+
+        //ǩkeyһ֣detachedнͬĽڵ
+        radix_tree_node<K, T, Compare>* spine = detached.new_node();
+        spine->m_depth = child->m_depth;
+        spine->m_parent = y;
+        set_key(spine, child->label(), child->m_key_len);
+        y->m_children.insert(spine->edge(), spine, *m_pool);
+        path.push_back(std::make_pair(child, spine));
+        x = child;
+        y = spine;
+        depth += child->m_key_len;
     }
 
-    if (grandparent->m_children.size() == 1) {
-        // merge grandparent with the uncle
-        typename std::map<K, radix_tree_node<K, T, Compare>*>::iterator it;
-        it = grandparent->m_children.begin();
+    //·ԵļֵֵĽڵûкӾɾֻһӾͺϲ
+    for (std::size_t i = path.size(); i-- != 0; ) {
+        recount(path[i].first);
+        recount(path[i].second);
+        compress(path[i].first);
+        detached.compress(path[i].second);
+    }
+    recount(m_root);
+    recount(detached.m_root);
 
-        radix_tree_node<K, T, Compare>* uncle = it->second;
+    out.merge(std::move(detached));
 
-        if (uncle->m_is_leaf)
-            return 1;
+    return count;
+}
 
-        uncle->m_depth = grandparent->m_depth;
-        uncle->m_key = radix_join(grandparent->m_key, uncle->m_key);
-        uncle->m_parent = grandparent->m_parent;
+template <typename K, typename T, typename Compare>
+template<class Resolve>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::merge(radix_tree&& other, Resolve resolve)
+{
+    if (&other == this)
+        return 0;
+    if (other.m_root == NULL || other.m_size == 0) {
+        other.clear();
+        return 0;
+    }
 
-        grandparent->m_children.erase(it);
+    radix_tree_node<K, T, Compare>* src = other.m_root;
+    if (other.m_pool != m_pool) {
+        //otherռڴڴأڵԭز
+        if (other.m_owns_pool && other.m_pool->slabs() == m_pool->slabs())
+            m_pool->merge(*other.m_pool);
+        else
+            src = transplant(src, *other.m_pool);
+    }
 
-        grandparent->m_parent->m_children.erase(grandparent->m_key);
-        grandparent->m_parent->m_children[uncle->m_key] = uncle;
+    //otherļֵȷfromϣҽʱƵm_list
+    radix_tree_link from;
+    move_run(other.m_list.m_next, &other.m_list, &from);
+    size_type incoming = other.m_size;
+    other.m_root = NULL;
+    other.m_size = 0;
 
-        delete grandparent;
+    if (m_root == NULL)
+        m_root = new_node();
+
+    size_type conflicts = 0;
+    std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> > work;
+    merge_node(m_root, src, resolve, conflicts, work);
+    while (!work.empty()) {
+        std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> w = work.back();
+        work.pop_back();
+        graft(w.first, w.second, resolve, conflicts, work);
     }
+    assert(from.m_next == &from);
 
-    return 1;
+    m_size += incoming - conflicts;
+
+    return conflicts;
 }
 
+template <typename K, typename T, typename Compare>
+template<class Resolve>
+void radix_tree<K, T, Compare>::merge_node(radix_tree_node<K, T, Compare>* a, radix_tree_node<K, T, Compare>* b, Resolve& resolve, size_type& conflicts,
+    std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> >& work)
+{
+    if (b->m_has_value) {
+        b->m_prev->m_next = b->m_next;
+        b->m_next->m_prev = b->m_prev;
+        if (a->m_has_value) {
+            resolve(a->m_value.second, b->m_value.second);
+            conflicts++;
+        }
+        else {
+            //aĺӶm_listϣlink_valueҵaĺ
+            a->set_value(std::move(b->m_value));
+            add_count(a, 1);
+            link_value(a);
+        }
+        b->clear_value();
+    }
+
+    for (radix_tree_node<K, T, Compare>* child = b->m_children.first(); child != NULL; child = b->m_children.next(child->edge()))
+        work.push_back(std::make_pair(a, child));
+    b->m_children.release(*m_pool);
+    delete_node(b);
+}
+
+template <typename K, typename T, typename Compare>
+template<class Resolve>
+void radix_tree<K, T, Compare>::graft(radix_tree_node<K, T, Compare>* a, radix_tree_node<K, T, Compare>* b, Resolve& resolve, size_type& conflicts,
+    std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> >& work)
+{
+    radix_tree_node<K, T, Compare>* child = a->m_children.find(b->edge());
+
+    if (child == NULL) {
+        //ûصba棬ļֵfromһΣƵm_list֮ĵһֵ֮ǰ
+        b->m_parent = a;
+        a->m_children.insert(b->edge(), b, *m_pool);
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+        add_count(a, static_cast<std::ptrdiff_t>(b->m_count));
+#endif
+        radix_tree_node<K, T, Compare>* after = skip_subtree(b);
+        move_run(first_value(b), last_value(b)->m_next, after != NULL ? static_cast<radix_tree_link*>(after) : &m_list);
+        return;
+    }
+
+    int n = child->m_key_len < b->m_key_len ? child->m_key_len : b->m_key_len;
+    int count = radix_mismatch(child->label(), b->label(), n);
+    if (count < child->m_key_len) {
+        //childıǩֻǰcountֽbͬһֵĽڵһ
+        RADIX_TREE_COUNT(m_counters.splits);
+        radix_tree_node<K, T, Compare>* node = new_node();
+        a->m_children.erase(child->edge(), *m_pool);
+        node->m_parent = a;
+        node->m_depth = child->m_depth;
+        set_key(node, child->label(), count);
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+        node->m_count = child->m_count;
+#endif
+        a->m_children.insert(node->edge(), node, *m_pool);
+
+        child->m_depth += count;
+        child->m_parent = node;
+        set_key(child, child->label() + count, child->m_key_len - count);
+        node->m_children.insert(child->edge(), child, *m_pool);
+        child = node;
+    }
+
+    if (count < b->m_key_len) {
+        b->m_depth += count;
+        set_key(b, b->label() + count, b->m_key_len - count);
+        work.push_back(std::make_pair(child, b));
+    }
+    else {
+        merge_node(child, b, resolve, conflicts, work);
+    }
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::transplant(radix_tree_node<K, T, Compare>* root, radix_tree_pool& from)
+{
+    //ջÿһfromеĽڵе¸ĸڵ
+    std::vector<std::pair<radix_tree_node<K, T, Compare>*, radix_tree_node<K, T, Compare>*> > stack;
+    radix_tree_node<K, T, Compare>* copy = NULL;
+
+    stack.push_back(std::make_pair(root, static_cast<radix_tree_node<K, T, Compare>*>(NULL)));
+    while (!stack.empty()) {
+        radix_tree_node<K, T, Compare>* node = stack.back().first;
+        radix_tree_node<K, T, Compare>* parent = stack.back().second;
+        stack.pop_back();
+
+        radix_tree_node<K, T, Compare>* n = new_node();
+        n->m_depth = node->m_depth;
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+        n->m_count = node->m_count;
+#endif
+        if (node->m_key_len != 0)
+            set_key(n, node->label(), node->m_key_len);
+        if (node->m_has_value) {
+            n->set_value(std::move(node->m_value));
+            n->m_prev = node->m_prev;
+            n->m_next = node->m_next;
+            n->m_prev->m_next = n;
+            n->m_next->m_prev = n;
+        }
+        n->m_parent = parent;
+        if (parent != NULL)
+            parent->m_children.insert(n->edge(), n, *m_pool);
+        else
+            copy = n;
+
+        for (radix_tree_node<K, T, Compare>* child = node->m_children.first(); child != NULL; child = node->m_children.next(child->edge()))
+            stack.push_back(std::make_pair(child, n));
+        node->free_label(from);
+        node->m_children.release(from);
+        node->~radix_tree_node();
+        from.deallocate(node, sizeof(radix_tree_node<K, T, Compare>));
+    }
+
+    return copy;
+}
+
+template <typename K, typename T, typename Compare>
+template<class _UnaryPred>
+typename radix_tree<K, T, Compare>::size_type radix_tree<K, T, Compare>::remove_if(_UnaryPred pred)
+{
+    size_type count = 0;
+
+    //ֵ˳һ飬ɾʱ͵ڵĸĸڵ㣻
+    //ֻͷŲֵĽڵ㣬ϵһڵ㲻Ӱ
+    radix_tree_link* link = m_list.m_next;
+    while (link != &m_list) {
+        radix_tree_node<K, T, Compare>* node = static_cast<radix_tree_node<K, T, Compare>*>(link);
+        link = link->m_next;
+        if (pred(node->m_value.first)) {
+            erase_node(node);
+            count++;
+        }
+    }
+
+    return count;
+}
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::append(radix_tree_node<K, T, Compare>* parent, const value_type& val)
+template<class... Args>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::append(radix_tree_node<K, T, Compare>* parent, int len_key, Args&&... args)
 {
-    //ֵ׷ڸĸڵĺӽڵ㣬Ҷӽڵָ
+    //ֵ׷ڸĸڵĺӽڵ㣬شżֵĽڵָ
     int depth;
     int len;
-    //ÿյļֵ
-    K   nul = radix_substr(val.first, 0, 0);
-    radix_tree_node<K, T, Compare>* node_c, * node_cc;
+    radix_tree_node<K, T, Compare>* node_c;
 
-    depth = parent->m_depth + radix_length(parent->m_key);
-    len = radix_length(val.first) - depth;
+    depth = parent->m_depth + parent->m_key_len;
+    len = len_key - depth;
 
     if (len == 0) {
         //ĸڵҪӵֵ
 
-        //ʵǸĸڵһҶӽڵ
-        node_c = new radix_tree_node<K, T, Compare>(val, m_predicate);
-        //븸ĸڵͬ
-        node_c->m_depth = depth;
-        node_c->m_parent = parent;
-        //ֵΪգҶӽڵ
-        node_c->m_key = nul;
-        node_c->m_is_leaf = true;
-        //ĸڵָӽڵΪýڵnode_c
-        parent->m_children[nul] = node_c;
+        //ֱֵӴڸĸڵ
+        parent->set_value(std::forward<Args>(args)...);
 
-        return node_c;
+        return parent;
     }
     else {
         //ĸڵҪӵֵȲ
-        node_c = new radix_tree_node<K, T, Compare>(val, m_predicate);
-        //ֵ븸ĸڵ㲻ͬӴΪkey_sub
-        K key_sub = radix_substr(val.first, depth, len);
-        //ĸڵָӽڵӴΪnode_c
-        parent->m_children[key_sub] = node_c;
-        //node_c
+        node_c = new_node();
+        //ȹŵֵǩӴõļֵиƣʱ˵ߵļֵ
+        node_c->set_value(std::forward<Args>(args)...);
+        //node_cãֵ븸ĸڵ㲻ͬĲΪnode_cıǩ
         node_c->m_depth = depth;
         node_c->m_parent = parent;
-        node_c->m_key = key_sub;
-        //node_ccΪnode_cĺӽڵ㣬ΪҶӽڵ
-        node_cc = new radix_tree_node<K, T, Compare>(val, m_predicate);
-        node_c->m_children[nul] = node_cc;
-
-        node_cc->m_depth = depth + len;
-        node_cc->m_parent = node_c;
-        node_cc->m_key = nul;
-        node_cc->m_is_leaf = true;
+        set_key(node_c, radix_data(node_c->m_value.first) + depth, len);
+        //ĸڵָӽڵӴΪnode_c
+        parent->m_children.insert(node_c->edge(), node_c, *m_pool);
 
-        return node_cc;
+        return node_c;
     }
 }
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::prepend(radix_tree_node<K, T, Compare>* node, const value_type& val)
+template<class... Args>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::prepend(radix_tree_node<K, T, Compare>* node, const char* key, int len, Args&&... args)
 {
     int count;
     int len1, len2;
 
-    len1 = radix_length(node->m_key);//ڵֵ
-    len2 = radix_length(val.first) - node->m_depth;//ڵֵȵĲֵ
-    //жϲֵֽڵֵǷͬһͬ˳ѭ0countͬcountܳȣͬ
-    for (count = 0; count < len1 && count < len2; count++) {
-        if (!(node->m_key[count] == val.first[count + node->m_depth]))
-            break;
-    }
+    len1 = node->m_key_len;//ڵֵ
+    len2 = len - node->m_depth;//ڵֵȵĲֵ
+    //жϲֵֽڵֵǷͬҵһͬλã0countͬcountܳȣͬ
+    count = radix_mismatch(node->label(), key + node->m_depth, len1 < len2 ? len1 : len2);
 
     assert(count != 0);
-    //ڵĸĸڵָӽڵɾڵļֵ
-    node->m_parent->m_children.erase(node->m_key);
+    RADIX_TREE_COUNT(m_counters.splits);
     //һµnode_aȥŽڵֵͬĴӣ0countֵļֵ
-    radix_tree_node<K, T, Compare>* node_a = new radix_tree_node<K, T, Compare>(m_predicate);
+    radix_tree_node<K, T, Compare>* node_a = new_node();
+    //node_b nodevalueͬģcountǶμֵԼֵ
+    radix_tree_node<K, T, Compare>* node_b = NULL;
+
+    //ȹŵֵ˺ٶkeyʱkeyڵļֵ
+    if (count == len2) {
+        node_a->set_value(std::forward<Args>(args)...);
+    }
+    else {
+        node_b = new_node();
+        node_b->set_value(std::forward<Args>(args)...);
+    }
+    //ڵĸĸڵָӽڵɾڵļֵ
+    node->m_parent->m_children.erase(node->edge(), *m_pool);
 
     node_a->m_parent = node->m_parent;
-    node_a->m_key = radix_substr(node->m_key, 0, count);
+    set_key(node_a, node->label(), count);
     node_a->m_depth = node->m_depth;
-    node_a->m_parent->m_children[node_a->m_key] = node_a;
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+    node_a->m_count = node->m_count;
+#endif
+    node_a->m_parent->m_children.insert(node_a->edge(), node_a, *m_pool);
 
     //node² nodeļֵΪnodeӣcountܳȣǲֵļֵ
     node->m_depth += count;
     node->m_parent = node_a;
-    node->m_key = radix_substr(node->m_key, count, len1 - count);
-    node->m_parent->m_children[node->m_key] = node;
-    //һҶӽڵ
-    K nul = radix_substr(val.first, 0, 0);
-    if (count == len2) {//Ҳ˵ֵһnodevalueһģһ׷һҶӽڵ
-        radix_tree_node<K, T, Compare>* node_b;
-
-        node_b = new radix_tree_node<K, T, Compare>(val, m_predicate);
-
-        node_b->m_parent = node_a;
-        node_b->m_key = nul;
-        node_b->m_depth = node_a->m_depth + count;
-        node_b->m_is_leaf = true;
-        node_b->m_parent->m_children[nul] = node_b;
-
-        return node_b;
+    set_key(node, node->label() + count, len1 - count);
+    node->m_parent->m_children.insert(node->edge(), node, *m_pool);
+    if (node_b == NULL) {//Ҳ˵ֵһnodevalueһģһֱֵӴnode_a
+        return node_a;
     }
     else {
-        //node_b nodevalueͬģcountǶμֵ
-        //node_cҶӽڵ
-        radix_tree_node<K, T, Compare>* node_b, * node_c;
-        
-        node_b = new radix_tree_node<K, T, Compare>(m_predicate);
-
         node_b->m_parent = node_a;
         node_b->m_depth = node->m_depth;
-        node_b->m_key = radix_substr(val.first, node_b->m_depth, len2 - count);
-        node_b->m_parent->m_children[node_b->m_key] = node_b;
-
-        node_c = new radix_tree_node<K, T, Compare>(val, m_predicate);
+        set_key(node_b, radix_data(node_b->m_value.first) + node_b->m_depth, len2 - count);
+        node_b->m_parent->m_children.insert(node_b->edge(), node_b, *m_pool);
 
-        node_c->m_parent = node_b;
-        node_c->m_depth = radix_length(val.first);
-        node_c->m_key = nul;
-        node_c->m_is_leaf = true;
-        node_c->m_parent->m_children[nul] = node_c;
-
-        return node_c;
+        return node_b;
     }
 }
 
 template <typename K, typename T, typename Compare>
-std::pair<typename radix_tree<K, T, Compare>::iterator, bool> radix_tree<K, T, Compare>::insert(const value_type& val)
+template<class... Args>
+std::pair<typename radix_tree<K, T, Compare>::iterator, bool> radix_tree<K, T, Compare>::insert_key(const char* key, int len, Args&&... args)
 {//ֵϢλãҶӱ־
     //ڵΪգһָռֵĸڵ
     if (m_root == NULL) {
-        K nul = radix_substr(val.first, 0, 0);
-        m_root = new radix_tree_node<K, T, Compare>(m_predicate);
-        m_root->m_key = nul;
+        m_root = new_node();
     }
 
-
-    radix_tree_node<K, T, Compare>* node = find_node(val.first, m_root, 0);
+    radix_tree_node<K, T, Compare>* node = find_node(key, len, m_root, 0);
     
-    if (node->m_is_leaf) {//ýڵҶӽڵ
+    if (node->m_has_value && node->m_depth + node->m_key_len == len && match_key(key, len, node)) {//ýڵѴֵ
         return std::pair<iterator, bool>(node, false);
     }
     else if (node == m_root) {//ýڵǸڵ㣬ֵ׷ӵڵĺӽڵ
-        m_size++;
-        return std::pair<iterator, bool>(append(m_root, val), true);
+        node = append(m_root, len, std::forward<Args>(args)...);
     }
     else {//ýڵ㲻Ǹڵ
-        m_size++;
-        int len = radix_length(node->m_key);
-
-        K   key_sub = radix_substr(val.first, node->m_depth, len);
-
-        if (key_sub == node->m_key) {//Ӵͽڵֵ
-            return std::pair<iterator, bool>(append(node, val), true);
+        if (match_key(key, len, node)) {//Ӵͽڵֵ
+            node = append(node, len, std::forward<Args>(args)...);
         }
         else {//Ӵͽڵֵ
-            return std::pair<iterator, bool>(prepend(node, val), true);
+            node = prepend(node, key, len, std::forward<Args>(args)...);
         }
     }
+
+    m_size++;
+    RADIX_TREE_COUNT(m_counters.inserts);
+    add_count(node, 1);
+    link_value(node);
+
+    return std::pair<iterator, bool>(node, true);
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::next_value(radix_tree_node<K, T, Compare>* node) const
+{
+    //ڵԼļֵĺ֮ǰ
+    radix_tree_node<K, T, Compare>* child = node->m_children.first();
+
+    if (child != NULL)
+        return first_value(child);
+    else
+        return skip_subtree(node);
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::first_value(radix_tree_node<K, T, Compare>* node) const
+{
+    //ֵĽڵӣصһһмֵĽڵ
+    while (!node->m_has_value)
+        node = node->m_children.first();
+
+    return node;
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::skip_subtree(radix_tree_node<K, T, Compare>* node) const
+{
+    //ҵһһֵܵ
+    for (;;) {
+        radix_tree_node<K, T, Compare>* parent = node->m_parent;
+        if (parent == NULL)
+            return NULL;
+
+        radix_tree_node<K, T, Compare>* next = parent->m_children.next(node->edge());
+        if (next != NULL)
+            return first_value(next);
+
+        node = parent;
+    }
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::link_value(radix_tree_node<K, T, Compare>* node)
+{
+    radix_tree_node<K, T, Compare>* next = next_value(node);
+    link_before(next != NULL ? static_cast<radix_tree_link*>(next) : &m_list, node);
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::link_before(radix_tree_link* succ, radix_tree_node<K, T, Compare>* node)
+{
+    node->m_next = succ;
+    node->m_prev = succ->m_prev;
+    succ->m_prev->m_next = node;
+    succ->m_prev = node;
 }
 
 template <typename K, typename T, typename Compare>
-typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::find(const K& key)
+typename radix_tree<K, T, Compare>::iterator radix_tree<K, T, Compare>::find(const char* key, int len)
 {
     if (m_root == NULL)
-        return iterator(NULL);
+        return end();
 
-    radix_tree_node<K, T, Compare>* node = find_node(key, m_root, 0);
+    radix_tree_node<K, T, Compare>* node = find_node(key, len, m_root, 0);
 
-    // if the node is a internal node, return NULL
-    if (!node->m_is_leaf)
-        return iterator(NULL);
+    //ûмֵڵʱend()
+    if (!node->m_has_value || node->m_depth + node->m_key_len != len || !match_key(key, len, node))
+        return end();
 
     return iterator(node);
 }
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::find_node(const K& key, radix_tree_node<K, T, Compare>* node, int depth)
-{//ӵǰڵnodeΪdepthʼҼֵkeyؽڵָ
-    //˵ڵ޺ӣؽڵ
-    if (node->m_children.empty())
-        return node;
-    //ڵĺӵ
-    typename radix_tree_node<K, T, Compare>::it_child it;
-    //ֵ-ǰ
-    int len_key = radix_length(key) - depth;
-    //ӵǰȿʼкӽڵ
-    for (it = node->m_children.begin(); it != node->m_children.end(); ++it) {
-        //ǰʵֵĳ
-        if (len_key == 0) {
-            //ǰʵĽڵҶӽڵ㣬򷵻ڵ㣬
-            if (it->second->m_is_leaf)
-                return it->second;
-            else
-                continue;
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::find_node(const char* key, int len, radix_tree_node<K, T, Compare>* node, int depth)
+{//ӵǰڵnodeΪdepthʼҼֵkeyؽڵָ룻һ·µѭݹ
+    if (depth == 0)
+        RADIX_TREE_COUNT(m_counters.lookups);
+    //ǰʵֵĳˣصǰڵ
+    while (depth != len) {
+        //Ӱֵĵһֵֻһ
+        radix_tree_node<K, T, Compare>* child = node->m_children.find(static_cast<unsigned char>(key[depth]));
+        if (child == NULL)
+            return node;
+
+        //ֵdepthʼĲֵchildıǩʱchildң򷵻child
+        RADIX_TREE_COUNT(m_counters.levels);
+        int len_node = child->m_key_len;
+        if (len_node > len - depth || !radix_equal(key + depth, child->label(), len_node))
+            return child;
+
+        node = child;
+        depth += len_node;
+    }
+
+    return node;
+}
+
+template <typename K, typename T, typename Compare>
+bool radix_tree<K, T, Compare>::match_key(const char* key, int len, radix_tree_node<K, T, Compare>* node) const
+{
+    unsigned depth = static_cast<unsigned>(node->m_depth);
+    if (depth > static_cast<unsigned>(len) || node->m_key_len > len - node->m_depth)
+        return false;
+
+    //ȽϵĳȡǩȺͼֵʣµֽнСһ䣻
+    //̵ַʱɴܿȽϲԽֵĩβ
+    unsigned rest = static_cast<unsigned>(len) - depth;
+    unsigned n = static_cast<unsigned>(node->m_key_len) < rest ? static_cast<unsigned>(node->m_key_len) : rest;
+    //ڵıǩΪ
+    return n == 0 || radix_equal(key + depth, node->label(), static_cast<int>(n));
+}
+
+template <typename K, typename T, typename Compare>
+radix_tree_node<K, T, Compare>* radix_tree<K, T, Compare>::new_node(radix_tree_pool& pool)
+{
+    return new (pool.allocate(sizeof(radix_tree_node<K, T, Compare>))) radix_tree_node<K, T, Compare>();
+}
+
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::delete_node(radix_tree_node<K, T, Compare>* node)
+{
+    assert(node->m_children.empty());
+
+    node->free_label(*m_pool);
+    node->m_children.release(*m_pool);
+    node->~radix_tree_node();
+    m_pool->deallocate(node, sizeof(radix_tree_node<K, T, Compare>));
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::delete_tree(radix_tree_pool& pool, radix_tree_node<K, T, Compare>* root)
+{
+    //ݹҲջͷŵĽڵm_parentʱڴ棬Ҳջ
+    root->m_parent = NULL;
+    radix_tree_node<K, T, Compare>* pending = root;
+    while (pending != NULL) {
+        radix_tree_node<K, T, Compare>* node = pending;
+        pending = node->m_parent;
+
+        node->m_children.for_each([&pending](unsigned char, radix_tree_node<K, T, Compare>* child) {
+            child->m_parent = pending;
+            pending = child;
+        });
+        node->m_children.release(pool);
+        node->free_label(pool);
+        node->~radix_tree_node();
+        pool.deallocate(node, sizeof(radix_tree_node<K, T, Compare>));
+    }
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::destroy_values(radix_tree_link& list)
+{
+    if (std::is_trivially_destructible<value_type>::value)
+        return;
+
+    //мֵĽڵ㶼ϣر
+    radix_tree_link* link = list.m_next;
+    while (link != &list) {
+        radix_tree_link* next = link->m_next;
+        static_cast<radix_tree_node<K, T, Compare>*>(link)->clear_value();
+        link = next;
+    }
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::release_tree(bool keep_pool)
+{
+    if (m_root != NULL) {
+        if (m_owns_pool && m_reclaimer != NULL && defer_teardown(keep_pool)) {
+            //ڵ㡢ֵͬڴѽ̨߳ͷ
         }
-        //ʵĵǰڵ㲻Ҷӽڵҵǰļֵֵڽڵļֵĵһֵһεĳ
-        if (!it->second->m_is_leaf && key[depth] == it->first[0]) {
-            int len_node = radix_length(it->first);
-            K   key_sub = radix_substr(key, depth, len_node);
-            //ͬĲkey_subʱǵit->firstǣҼֵit->secondڵdepth+len_nodeڵ㣬ǣͷصǰit->secondڵ
-            if (key_sub == it->first) {
-                return find_node(key, it->second, depth + len_node);
-            }
-            else {
-                return it->second;
-            }
+        else if (m_owns_pool && m_pool->slabs()) {
+            //ڴֻŵֵڴһι黹ͷŽڵ
+            destroy_values(m_list);
+            m_pool->release();
+        }
+        else {
+            delete_tree(*m_pool, m_root);
         }
     }
+    m_list.m_prev = m_list.m_next = &m_list;
+    m_root = NULL;
+    m_size = 0;
+}
 
-    return node;
+template <typename K, typename T, typename Compare>
+bool radix_tree<K, T, Compare>::defer_teardown(bool keep_pool)
+{
+    //ҪĶȷãʧʱʲôûиĶ
+    std::unique_ptr<teardown> t;
+    std::unique_ptr<radix_tree_pool> pool;
+    try {
+        t.reset(new teardown);
+        if (keep_pool)
+            pool.reset(new radix_tree_pool(m_pool->chunk_size()));
+    }
+    catch (...) {
+        return false;
+    }
+
+    t->pool = m_pool;
+    t->root = m_root;
+    if (m_list.m_next != &m_list)
+        move_run(m_list.m_next, &m_list, &t->list);
+    //deferɹ̨߳ʱͷžɵڴأҪȶ
+    std::size_t served = m_pool->allocations();
+
+    try {
+        m_reclaimer->defer(t.get(), &reclaim);
+    }
+    catch (...) {
+        //ûнȥ
+        if (t->list.m_next != &t->list)
+            move_run(t->list.m_next, &t->list, &m_list);
+        return false;
+    }
+
+    //ȥ֮ŷȨڴصžɵڴؼ
+    t.release();
+    m_counters.allocations -= served;
+    m_pool = pool.release();
+    return true;
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree<K, T, Compare>::reclaim(void* p)
+{
+    std::unique_ptr<teardown> t(static_cast<teardown*>(p));
+
+    if (t->pool->slabs())
+        destroy_values(t->list);
+    else
+        delete_tree(*t->pool, t->root);
+    delete t->pool;
 }
 
 #endif // RADIX_TREE_HPP
\ No newline at end of file
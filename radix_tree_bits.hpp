@@ -0,0 +1,161 @@
+#pragma once
+#include<cstddef>
+#include<cstdint>
+#include<stdexcept>
+#include<vector>
+
+#include "radix_tree_simd.hpp"
+
+// Append-only bit vector with constant-time rank and near constant-time select,
+// the building block of frozen_radix_tree. Bits are appended with push_back and
+// build() then adds the directories: the number of ones before every 512-bit
+// block, and for every 512th one and every 512th zero the block it falls in.
+// rank1 is a directory lookup plus popcounts over at most eight words; select
+// starts from the sampled block, binary searches the block counts up to the next
+// sample and finishes inside one word. The directories cost about 6% on top of
+// the bits themselves.
+class radix_bit_vector {
+public:
+	// the directories count in 32 bits
+	static const std::uint64_t max_bits = 0xFFFFFFFFu;
+
+	radix_bit_vector() :m_size(0) { }
+
+	void push_back(bool bit);
+	// builds the rank and select directories, call once after the last push_back;
+	// throws std::length_error, changing nothing, past max_bits
+	void build();
+
+	std::size_t size() const { return m_size; }
+	bool operator[](std::size_t i) const { return (m_words[i / 64] >> (i % 64)) & 1; }
+	// number of ones in [0, i)
+	std::size_t rank1(std::size_t i) const;
+	std::size_t rank0(std::size_t i) const { return i - rank1(i); }
+	// position of the one (zero) with k ones (zeros) before it
+	std::size_t select1(std::size_t k) const { return select(k, true); }
+	std::size_t select0(std::size_t k) const { return select(k, false); }
+	// position of the first one (zero) at or after i, size() when there is none
+	std::size_t next1(std::size_t i) const { return next(i, true); }
+	std::size_t next0(std::size_t i) const { return next(i, false); }
+	std::size_t bytes() const;
+private:
+	enum { block_words = 8, block_bits = 512, sample = 512 };
+
+	std::size_t select(std::size_t k, bool one) const;
+	std::size_t next(std::size_t i, bool one) const;
+	// ones (zeros) before block b
+	std::size_t before(std::size_t b, bool one) const { return one ? m_ranks[b] : b * block_bits - m_ranks[b]; }
+	// position in w of the set bit with k set bits below it
+	static int select64(std::uint64_t w, std::size_t k);
+
+	std::vector<std::uint64_t> m_words;
+	// ones before each block, with a last entry for the end
+	std::vector<std::uint32_t> m_ranks;
+	// block of every sample-th one and zero
+	std::vector<std::uint32_t> m_select1;
+	std::vector<std::uint32_t> m_select0;
+	std::size_t m_size;
+};
+
+inline void radix_bit_vector::push_back(bool bit)
+{
+	if (m_size % 64 == 0)
+		m_words.push_back(0);
+	if (bit)
+		m_words.back() |= std::uint64_t(1) << (m_size % 64);
+	m_size++;
+}
+
+inline void radix_bit_vector::build()
+{
+	std::size_t blocks = (m_words.size() + block_words - 1) / block_words;
+	std::size_t ones = 0, zeros = 0;
+
+	if (m_size > max_bits)
+		throw std::length_error("radix_bit_vector: more bits than the 32-bit rank directory counts");
+
+	// padding words let the scans read whole blocks
+	m_words.resize(blocks * block_words, 0);
+	m_ranks.assign(1, 0);
+	m_select1.clear();
+	m_select0.clear();
+	for (std::size_t b = 0; b < blocks; b++) {
+		std::size_t count = 0;
+		for (std::size_t w = 0; w < block_words; w++)
+			count += radix_popcount64(m_words[b * block_words + w]);
+		std::size_t bits = (b + 1) * block_bits < m_size ? std::size_t(block_bits) : m_size - b * block_bits;
+		// a sample falls in this block when the block takes the count past a multiple of sample
+		for (; m_select1.size() * sample < ones + count; )
+			m_select1.push_back(static_cast<std::uint32_t>(b));
+		for (; m_select0.size() * sample < zeros + bits - count; )
+			m_select0.push_back(static_cast<std::uint32_t>(b));
+		ones += count;
+		zeros += bits - count;
+		m_ranks.push_back(static_cast<std::uint32_t>(ones));
+	}
+}
+
+inline std::size_t radix_bit_vector::rank1(std::size_t i) const
+{
+	std::size_t b = i / block_bits;
+	std::size_t count = m_ranks[b];
+
+	for (std::size_t w = b * block_words; w < i / 64; w++)
+		count += radix_popcount64(m_words[w]);
+	if (i % 64 != 0)
+		count += radix_popcount64(m_words[i / 64] & ((std::uint64_t(1) << (i % 64)) - 1));
+
+	return count;
+}
+
+inline int radix_bit_vector::select64(std::uint64_t w, std::size_t k)
+{
+	for (; k != 0; k--)
+		w &= w - 1;
+
+	return radix_ctz64(w);
+}
+
+inline std::size_t radix_bit_vector::select(std::size_t k, bool one) const
+{
+	const std::vector<std::uint32_t>& samples = one ? m_select1 : m_select0;
+	std::size_t b = samples[k / sample];
+	std::size_t e = k / sample + 1 < samples.size() ? samples[k / sample + 1] : m_ranks.size() - 2;
+
+	// the last block in [b, e] with at most k ones (zeros) before it
+	while (b < e) {
+		std::size_t mid = b + (e - b + 1) / 2;
+		if (before(mid, one) <= k)
+			b = mid;
+		else
+			e = mid - 1;
+	}
+	k -= before(b, one);
+	for (std::size_t w = b * block_words; ; w++) {
+		std::uint64_t word = one ? m_words[w] : ~m_words[w];
+		std::size_t count = radix_popcount64(word);
+		if (k < count)
+			return w * 64 + select64(word, k);
+		k -= count;
+	}
+}
+
+inline std::size_t radix_bit_vector::next(std::size_t i, bool one) const
+{
+	for (std::size_t w = i / 64; w < m_words.size(); w++) {
+		std::uint64_t word = one ? m_words[w] : ~m_words[w];
+		if (w == i / 64)
+			word &= ~std::uint64_t(0) << (i % 64);
+		if (word != 0) {
+			std::size_t pos = w * 64 + radix_ctz64(word);
+			return pos < m_size ? pos : m_size;
+		}
+	}
+
+	return m_size;
+}
+
+inline std::size_t radix_bit_vector::bytes() const
+{
+	return m_words.capacity() * sizeof(std::uint64_t) + (m_ranks.capacity() + m_select1.capacity() + m_select0.capacity()) * sizeof(std::uint32_t);
+}
@@ -0,0 +1,538 @@
+#pragma once
+#include<cassert>
+#include<cstddef>
+#include<cstring>
+
+#include "radix_tree_pool.hpp"
+#include "radix_tree_simd.hpp"
+
+// Child index of a radix_tree_node, in the style of the Adaptive Radix Tree.
+// Sibling edges always differ in their first element, so children are keyed
+// by that byte alone and kept in one of four fixed-capacity layouts that grow
+// and shrink with the fanout:
+//   node4/node16 - sorted key bytes next to a child array, node16 searched with SIMD
+//   node48       - 256-entry byte index into 48 child slots
+//   node256      - child array indexed directly by the byte
+// Children are visited in unsigned byte order, which is the order std::less<std::string> gives.
+// Blocks come from the owning tree's radix_tree_pool, which every mutating call takes.
+template<typename Node>
+class radix_tree_children {
+public:
+	radix_tree_children() :m_kind(kind_node4), m_size(0), m_block(NULL) { }
+
+	int size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	Node* find(unsigned char c) const;
+	// starts loading the part of the block that find(c) will read
+	void prefetch(unsigned char c) const;
+	void insert(unsigned char c, Node* child, radix_tree_pool& pool);
+	void erase(unsigned char c, radix_tree_pool& pool);
+	void release(radix_tree_pool& pool);
+	Node* first() const;
+	Node* last() const;
+	Node* next(unsigned char c) const;
+	// calls visit(c, child) for every child in byte order, reading only the block and not the children
+	template<class Visitor> void for_each(Visitor visit) const;
+	// size of the block holding the children, 0 when there is none
+	std::size_t bytes() const;
+private:
+	enum { kind_node4, kind_node16, kind_node48, kind_node256 };
+	struct node4 { unsigned char keys[4]; Node* children[4]; };
+	struct node16 { unsigned char keys[16]; Node* children[16]; };
+	struct node48 { unsigned char index[256]; Node* children[48]; };
+	struct node256 { Node* children[256]; };
+
+	radix_tree_children(const radix_tree_children&);
+	radix_tree_children& operator=(const radix_tree_children&);
+
+	static int find_pos(const node4* b, int n, unsigned char c);
+	static int find_pos(const node16* b, int n, unsigned char c) { return radix_find16(b->keys, n, c); }
+	static int upper_pos(const node4* b, int n, unsigned char c);
+	static int upper_pos(const node16* b, int n, unsigned char c) { return radix_upper16(b->keys, n, c); }
+	template<typename Block> static Node* sorted_find(const Block* b, int n, unsigned char c);
+	template<typename Block> static Node* sorted_next(const Block* b, int n, unsigned char c);
+	template<typename Block> static bool sorted_insert(Block* b, int n, unsigned char c, Node* child);
+	template<typename Block> static bool sorted_erase(Block* b, int n, unsigned char c);
+	template<typename Block> static Block* make(radix_tree_pool& pool) { return new (pool.allocate(sizeof(Block))) Block(); }
+	template<typename Block> static void drop(Block* b, radix_tree_pool& pool) { pool.deallocate(b, sizeof(Block)); }
+	int capacity() const;
+	void grow(radix_tree_pool& pool);
+	void shrink(radix_tree_pool& pool);
+
+	unsigned char m_kind;
+	unsigned short m_size;
+	void* m_block;
+};
+
+template<typename Node>
+void radix_tree_children<Node>::release(radix_tree_pool& pool)
+{
+	if (m_block != NULL) {
+		switch (m_kind) {
+		case kind_node4: drop(static_cast<node4*>(m_block), pool); break;
+		case kind_node16: drop(static_cast<node16*>(m_block), pool); break;
+		case kind_node48: drop(static_cast<node48*>(m_block), pool); break;
+		case kind_node256: drop(static_cast<node256*>(m_block), pool); break;
+		}
+	}
+	m_kind = kind_node4;
+	m_size = 0;
+	m_block = NULL;
+}
+
+template<typename Node>
+int radix_tree_children<Node>::capacity() const
+{
+	if (m_block == NULL)
+		return 0;
+
+	switch (m_kind) {
+	case kind_node4: return 4;
+	case kind_node16: return 16;
+	case kind_node48: return 48;
+	default: return 256;
+	}
+}
+
+template<typename Node>
+std::size_t radix_tree_children<Node>::bytes() const
+{
+	if (m_block == NULL)
+		return 0;
+
+	switch (m_kind) {
+	case kind_node4: return sizeof(node4);
+	case kind_node16: return sizeof(node16);
+	case kind_node48: return sizeof(node48);
+	default: return sizeof(node256);
+	}
+}
+
+template<typename Node>
+int radix_tree_children<Node>::find_pos(const node4* b, int n, unsigned char c)
+{
+	for (int i = 0; i < n; i++) {
+		if (b->keys[i] == c)
+			return i;
+	}
+	return -1;
+}
+
+template<typename Node>
+int radix_tree_children<Node>::upper_pos(const node4* b, int n, unsigned char c)
+{
+	int i;
+	for (i = 0; i < n && b->keys[i] <= c; i++)
+		;
+	return i;
+}
+
+template<typename Node>
+template<typename Block>
+Node* radix_tree_children<Node>::sorted_find(const Block* b, int n, unsigned char c)
+{
+	int pos = find_pos(b, n, c);
+	return pos >= 0 ? b->children[pos] : NULL;
+}
+
+template<typename Node>
+template<typename Block>
+Node* radix_tree_children<Node>::sorted_next(const Block* b, int n, unsigned char c)
+{
+	int pos = upper_pos(b, n, c);
+	return pos < n ? b->children[pos] : NULL;
+}
+
+template<typename Node>
+template<typename Block>
+bool radix_tree_children<Node>::sorted_insert(Block* b, int n, unsigned char c, Node* child)
+{
+	int pos = find_pos(b, n, c);
+	if (pos >= 0) {
+		b->children[pos] = child;
+		return false;
+	}
+
+	pos = upper_pos(b, n, c);
+	memmove(b->keys + pos + 1, b->keys + pos, n - pos);
+	memmove(b->children + pos + 1, b->children + pos, (n - pos) * sizeof(Node*));
+	b->keys[pos] = c;
+	b->children[pos] = child;
+	return true;
+}
+
+template<typename Node>
+template<typename Block>
+bool radix_tree_children<Node>::sorted_erase(Block* b, int n, unsigned char c)
+{
+	int pos = find_pos(b, n, c);
+	if (pos < 0)
+		return false;
+
+	memmove(b->keys + pos, b->keys + pos + 1, n - pos - 1);
+	memmove(b->children + pos, b->children + pos + 1, (n - pos - 1) * sizeof(Node*));
+	return true;
+}
+
+template<typename Node>
+Node* radix_tree_children<Node>::find(unsigned char c) const
+{
+	if (m_size == 0)
+		return NULL;
+
+	switch (m_kind) {
+	case kind_node4: {
+		node4* b = static_cast<node4*>(m_block);
+		return sorted_find(b, m_size, c);
+	}
+	case kind_node16: {
+		node16* b = static_cast<node16*>(m_block);
+		return sorted_find(b, m_size, c);
+	}
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		return b->index[c] ? b->children[b->index[c] - 1] : NULL;
+	}
+	default:
+		return static_cast<node256*>(m_block)->children[c];
+	}
+}
+
+template<typename Node>
+void radix_tree_children<Node>::prefetch(unsigned char c) const
+{
+	if (m_size == 0)
+		return;
+
+	switch (m_kind) {
+	case kind_node48:
+		radix_prefetch(&static_cast<node48*>(m_block)->index[c]);
+		break;
+	case kind_node256:
+		radix_prefetch(&static_cast<node256*>(m_block)->children[c]);
+		break;
+	default:
+		radix_prefetch(m_block);
+	}
+}
+
+template<typename Node>
+Node* radix_tree_children<Node>::first() const
+{
+	if (m_size == 0)
+		return NULL;
+
+	switch (m_kind) {
+	case kind_node4: return static_cast<node4*>(m_block)->children[0];
+	case kind_node16: return static_cast<node16*>(m_block)->children[0];
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		for (int i = 0; i < 256; i++) {
+			if (b->index[i])
+				return b->children[b->index[i] - 1];
+		}
+		return NULL;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		for (int i = 0; i < 256; i++) {
+			if (b->children[i])
+				return b->children[i];
+		}
+		return NULL;
+	}
+	}
+}
+
+template<typename Node>
+Node* radix_tree_children<Node>::last() const
+{
+	if (m_size == 0)
+		return NULL;
+
+	switch (m_kind) {
+	case kind_node4: return static_cast<node4*>(m_block)->children[m_size - 1];
+	case kind_node16: return static_cast<node16*>(m_block)->children[m_size - 1];
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		for (int i = 255; i >= 0; i--) {
+			if (b->index[i])
+				return b->children[b->index[i] - 1];
+		}
+		return NULL;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		for (int i = 255; i >= 0; i--) {
+			if (b->children[i])
+				return b->children[i];
+		}
+		return NULL;
+	}
+	}
+}
+
+template<typename Node>
+template<class Visitor>
+void radix_tree_children<Node>::for_each(Visitor visit) const
+{
+	if (m_size == 0)
+		return;
+
+	switch (m_kind) {
+	case kind_node4: {
+		node4* b = static_cast<node4*>(m_block);
+		for (int i = 0; i < m_size; i++)
+			visit(b->keys[i], b->children[i]);
+		break;
+	}
+	case kind_node16: {
+		node16* b = static_cast<node16*>(m_block);
+		for (int i = 0; i < m_size; i++)
+			visit(b->keys[i], b->children[i]);
+		break;
+	}
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		for (int i = 0; i < 256; i++) {
+			if (b->index[i])
+				visit(static_cast<unsigned char>(i), b->children[b->index[i] - 1]);
+		}
+		break;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		for (int i = 0; i < 256; i++) {
+			if (b->children[i])
+				visit(static_cast<unsigned char>(i), b->children[i]);
+		}
+	}
+	}
+}
+
+template<typename Node>
+Node* radix_tree_children<Node>::next(unsigned char c) const
+{
+	if (m_size == 0)
+		return NULL;
+
+	switch (m_kind) {
+	case kind_node4: {
+		node4* b = static_cast<node4*>(m_block);
+		return sorted_next(b, m_size, c);
+	}
+	case kind_node16: {
+		node16* b = static_cast<node16*>(m_block);
+		return sorted_next(b, m_size, c);
+	}
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		for (int i = c + 1; i < 256; i++) {
+			if (b->index[i])
+				return b->children[b->index[i] - 1];
+		}
+		return NULL;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		for (int i = c + 1; i < 256; i++) {
+			if (b->children[i])
+				return b->children[i];
+		}
+		return NULL;
+	}
+	}
+}
+
+template<typename Node>
+void radix_tree_children<Node>::insert(unsigned char c, Node* child, radix_tree_pool& pool)
+{
+	assert(child != NULL);
+
+	if (m_size == capacity() && find(c) == NULL)
+		grow(pool);
+
+	switch (m_kind) {
+	case kind_node4: {
+		node4* b = static_cast<node4*>(m_block);
+		if (sorted_insert(b, m_size, c, child))
+			m_size++;
+		break;
+	}
+	case kind_node16: {
+		node16* b = static_cast<node16*>(m_block);
+		if (sorted_insert(b, m_size, c, child))
+			m_size++;
+		break;
+	}
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		if (b->index[c]) {
+			b->children[b->index[c] - 1] = child;
+			break;
+		}
+		int slot;
+		for (slot = 0; b->children[slot] != NULL; slot++)
+			;
+		b->children[slot] = child;
+		b->index[c] = static_cast<unsigned char>(slot + 1);
+		m_size++;
+		break;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		if (b->children[c] == NULL)
+			m_size++;
+		b->children[c] = child;
+		break;
+	}
+	}
+}
+
+template<typename Node>
+void radix_tree_children<Node>::erase(unsigned char c, radix_tree_pool& pool)
+{
+	if (m_size == 0)
+		return;
+
+	switch (m_kind) {
+	case kind_node4: {
+		node4* b = static_cast<node4*>(m_block);
+		if (sorted_erase(b, m_size, c))
+			m_size--;
+		break;
+	}
+	case kind_node16: {
+		node16* b = static_cast<node16*>(m_block);
+		if (sorted_erase(b, m_size, c))
+			m_size--;
+		break;
+	}
+	case kind_node48: {
+		node48* b = static_cast<node48*>(m_block);
+		if (b->index[c]) {
+			b->children[b->index[c] - 1] = NULL;
+			b->index[c] = 0;
+			m_size--;
+		}
+		break;
+	}
+	default: {
+		node256* b = static_cast<node256*>(m_block);
+		if (b->children[c]) {
+			b->children[c] = NULL;
+			m_size--;
+		}
+		break;
+	}
+	}
+
+	shrink(pool);
+}
+
+template<typename Node>
+void radix_tree_children<Node>::grow(radix_tree_pool& pool)
+{
+	switch (m_kind) {
+	case kind_node4: {
+		node4* old = static_cast<node4*>(m_block);
+		if (old == NULL) {
+			m_block = make<node4>(pool);
+			return;
+		}
+		node16* b = make<node16>(pool);
+		memcpy(b->keys, old->keys, m_size);
+		memcpy(b->children, old->children, m_size * sizeof(Node*));
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node16;
+		break;
+	}
+	case kind_node16: {
+		node16* old = static_cast<node16*>(m_block);
+		node48* b = make<node48>(pool);
+		for (int i = 0; i < m_size; i++) {
+			b->children[i] = old->children[i];
+			b->index[old->keys[i]] = static_cast<unsigned char>(i + 1);
+		}
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node48;
+		break;
+	}
+	case kind_node48: {
+		node48* old = static_cast<node48*>(m_block);
+		node256* b = make<node256>(pool);
+		for (int i = 0; i < 256; i++) {
+			if (old->index[i])
+				b->children[i] = old->children[old->index[i] - 1];
+		}
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node256;
+		break;
+	}
+	}
+}
+
+template<typename Node>
+void radix_tree_children<Node>::shrink(radix_tree_pool& pool)
+{
+	// shrink well below the capacity of the smaller layout so that a fanout
+	// oscillating around a boundary does not reallocate on every insert/erase
+	switch (m_kind) {
+	case kind_node4: {
+		if (m_size == 0)
+			release(pool);
+		break;
+	}
+	case kind_node16: {
+		if (m_size > 3)
+			break;
+		node16* old = static_cast<node16*>(m_block);
+		node4* b = make<node4>(pool);
+		memcpy(b->keys, old->keys, m_size);
+		memcpy(b->children, old->children, m_size * sizeof(Node*));
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node4;
+		break;
+	}
+	case kind_node48: {
+		if (m_size > 12)
+			break;
+		node48* old = static_cast<node48*>(m_block);
+		node16* b = make<node16>(pool);
+		int n = 0;
+		for (int i = 0; i < 256; i++) {
+			if (old->index[i]) {
+				b->keys[n] = static_cast<unsigned char>(i);
+				b->children[n] = old->children[old->index[i] - 1];
+				n++;
+			}
+		}
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node16;
+		break;
+	}
+	case kind_node256: {
+		if (m_size > 37)
+			break;
+		node256* old = static_cast<node256*>(m_block);
+		node48* b = make<node48>(pool);
+		int n = 0;
+		for (int i = 0; i < 256; i++) {
+			if (old->children[i]) {
+				b->children[n] = old->children[i];
+				b->index[i] = static_cast<unsigned char>(n + 1);
+				n++;
+			}
+		}
+		drop(old, pool);
+		m_block = b;
+		m_kind = kind_node48;
+		break;
+	}
+	}
+}
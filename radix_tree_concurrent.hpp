@@ -0,0 +1,712 @@
+#pragma once
+#include<algorithm>
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<new>
+#include<thread>
+#include<utility>
+#include<vector>
+
+#include "radix_tree.hpp"
+#include "radix_tree_epoch.hpp"
+
+// A radix tree for many threads, built on optimistic lock coupling. Every node
+// carries a version word: bit 1 is the write lock, bit 0 marks a node that has
+// been unlinked. Readers never write shared memory: they note a node's version,
+// read it, and check the version is unchanged before moving to the child, and
+// start over from the root when it is not. Writers descend the same way and then
+// lock only the nodes they change: the parent whose child index changes, a child
+// that is split, and the nodes an erase merges.
+//
+// Everything a reader can reach is either immutable or an atomic pointer: edge
+// labels are fixed when a node is created (a split or merge replaces the node),
+// a child block is copied, never changed in place, and a value is replaced as a
+// whole. Replaced memory is freed through radix_tree_epoch once no reader can
+// still hold it. Lookups return copies of the stored values for the same reason.
+template<typename K, typename T>
+class concurrent_radix_tree {
+public:
+	typedef K key_type;
+	typedef T mapped_type;
+	typedef std::pair<const K, T> value_type;
+	typedef std::size_t size_type;
+
+	concurrent_radix_tree();
+	~concurrent_radix_tree();
+
+	// exact while no writer is running, a recent count otherwise
+	size_type size() const { return m_size.load(std::memory_order_relaxed); }
+	bool empty() const { return size() == 0; }
+
+	bool find(const K& key, T& value) const { return find(radix_data(key), radix_length(key), value); }
+	bool longest_match(const K& key, K& match, T& value) const { return longest_match(radix_data(key), radix_length(key), match, value); }
+	// copies of every element whose key starts with key, in key order, taken from one consistent state of the subtree
+	void prefix_match(const K& key, std::vector<value_type>& vec) const { prefix_match(radix_data(key), radix_length(key), vec); }
+	bool insert(const value_type& val);
+	bool erase(const K& key) { return erase(radix_data(key), radix_length(key)); }
+
+	bool find(const char* key, int len, T& value) const;
+	bool longest_match(const char* key, int len, K& match, T& value) const;
+	void prefix_match(const char* key, int len, std::vector<value_type>& vec) const;
+	bool erase(const char* key, int len);
+private:
+	struct block;
+	struct node {
+		std::atomic<std::uint64_t> m_version;
+		std::atomic<block*> m_children;
+		std::atomic<value_type*> m_value;
+		int m_depth;
+		int m_key_len;
+		// the edge label is stored right behind the node
+		const char* key() const { return reinterpret_cast<const char*>(this + 1); }
+		unsigned char edge() const { return static_cast<unsigned char>(key()[0]); }
+	};
+	// children sorted by edge byte; a block is immutable once published
+	struct block {
+		std::size_t m_size;
+		node** children() { return reinterpret_cast<node**>(this + 1); }
+		unsigned char* keys() { return reinterpret_cast<unsigned char*>(children() + m_size); }
+	};
+
+	concurrent_radix_tree(const concurrent_radix_tree&);
+	concurrent_radix_tree& operator=(const concurrent_radix_tree&);
+
+	static bool read_lock(node* n, std::uint64_t& version);
+	static bool check(node* n, std::uint64_t version) { return n->m_version.load(std::memory_order_acquire) == version; }
+	static bool upgrade(node* n, std::uint64_t version) { return n->m_version.compare_exchange_strong(version, version + 2, std::memory_order_acquire); }
+	static void unlock(node* n) { n->m_version.fetch_add(2, std::memory_order_release); }
+	static void unlock_obsolete(node* n) { n->m_version.fetch_add(3, std::memory_order_release); }
+
+	static node* make_node(int depth, const char* key, int len, block* children, value_type* value);
+	static node* make_node(int depth, const char* key1, int len1, const char* key2, int len2, block* children, value_type* value);
+	static block* make_block(std::size_t size);
+	static node* block_find(block* b, unsigned char c);
+	// copy of b with child added, replacing the child with the same edge byte
+	static block* block_with(block* b, node* child);
+	// copy of b without the child indexed by c, NULL when nothing is left
+	static block* block_without(block* b, unsigned char c);
+
+	static void free_node(void* p) { ::operator delete(p); }
+	static void free_block(void* p) { ::operator delete(p); }
+	static void free_value(void* p) { delete static_cast<value_type*>(p); }
+	static void delete_tree(node* n);
+
+	// what an update allocates before it takes any lock, so that a bad_alloc never leaves a node
+	// locked: the nodes and blocks are freed when the update restarts or throws, the value when
+	// it is never published
+	class draft {
+	public:
+		draft() :m_value(NULL), m_node_count(0), m_block_count(0) { }
+		~draft() { discard(); free_value(m_value); }
+
+		value_type* value(const value_type& val) { return m_value != NULL ? m_value : m_value = new value_type(val); }
+		node* add(node* n) { return m_nodes[m_node_count++] = n; }
+		block* add(block* b) { return m_blocks[m_block_count++] = b; }
+		void discard();
+		// the update is visible, nothing it allocated may be freed any more
+		void publish() { m_value = NULL; m_node_count = 0; m_block_count = 0; }
+	private:
+		draft(const draft&);
+		draft& operator=(const draft&);
+
+		value_type* m_value;
+		node* m_nodes[3];
+		block* m_blocks[3];
+		int m_node_count;
+		int m_block_count;
+	};
+
+	node* m_root;
+	std::atomic<size_type> m_size;
+	mutable radix_tree_epoch m_epoch;
+};
+
+template<typename K, typename T>
+concurrent_radix_tree<K, T>::concurrent_radix_tree() :m_root(make_node(0, NULL, 0, NULL, NULL)), m_size(0)
+{
+}
+
+template<typename K, typename T>
+concurrent_radix_tree<K, T>::~concurrent_radix_tree()
+{
+	delete_tree(m_root);
+}
+
+template<typename K, typename T>
+void concurrent_radix_tree<K, T>::delete_tree(node* root)
+{
+	// an explicit stack, so that a deep tree cannot overflow the call stack
+	std::vector<node*> stack(1, root);
+
+	while (!stack.empty()) {
+		node* n = stack.back();
+		stack.pop_back();
+
+		block* b = n->m_children.load(std::memory_order_relaxed);
+		if (b != NULL) {
+			stack.insert(stack.end(), b->children(), b->children() + b->m_size);
+			free_block(b);
+		}
+		free_value(n->m_value.load(std::memory_order_relaxed));
+		free_node(n);
+	}
+}
+
+template<typename K, typename T>
+void concurrent_radix_tree<K, T>::draft::discard()
+{
+	for (int i = 0; i < m_node_count; i++)
+		free_node(m_nodes[i]);
+	for (int i = 0; i < m_block_count; i++)
+		free_block(m_blocks[i]);
+	m_node_count = 0;
+	m_block_count = 0;
+}
+
+template<typename K, typename T>
+bool concurrent_radix_tree<K, T>::read_lock(node* n, std::uint64_t& version)
+{
+	for (int spin = 0; ; spin++) {
+		version = n->m_version.load(std::memory_order_acquire);
+		if ((version & 2) == 0)
+			break;
+		if (spin > 64)
+			std::this_thread::yield();
+	}
+
+	return (version & 1) == 0;
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::node* concurrent_radix_tree<K, T>::make_node(int depth, const char* key, int len, block* children, value_type* value)
+{
+	return make_node(depth, key, len, NULL, 0, children, value);
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::node* concurrent_radix_tree<K, T>::make_node(int depth, const char* key1, int len1, const char* key2, int len2, block* children, value_type* value)
+{
+	node* n = static_cast<node*>(::operator new(sizeof(node) + len1 + len2));
+
+	new (&n->m_version) std::atomic<std::uint64_t>(0);
+	new (&n->m_children) std::atomic<block*>(children);
+	new (&n->m_value) std::atomic<value_type*>(value);
+	n->m_depth = depth;
+	n->m_key_len = len1 + len2;
+	if (len1 != 0)
+		memcpy(reinterpret_cast<char*>(n + 1), key1, len1);
+	if (len2 != 0)
+		memcpy(reinterpret_cast<char*>(n + 1) + len1, key2, len2);
+
+	return n;
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::block* concurrent_radix_tree<K, T>::make_block(std::size_t size)
+{
+	block* b = static_cast<block*>(::operator new(sizeof(block) + size * (sizeof(node*) + 1)));
+
+	b->m_size = size;
+
+	return b;
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::node* concurrent_radix_tree<K, T>::block_find(block* b, unsigned char c)
+{
+	if (b == NULL)
+		return NULL;
+
+	unsigned char* keys = b->keys();
+	unsigned char* pos = std::lower_bound(keys, keys + b->m_size, c);
+
+	return pos != keys + b->m_size && *pos == c ? b->children()[pos - keys] : NULL;
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::block* concurrent_radix_tree<K, T>::block_with(block* b, node* child)
+{
+	std::size_t size = b != NULL ? b->m_size : 0;
+	unsigned char c = child->edge();
+	std::size_t pos = 0;
+
+	while (pos < size && b->keys()[pos] < c)
+		pos++;
+
+	bool replace = pos < size && b->keys()[pos] == c;
+	block* copy = make_block(replace ? size : size + 1);
+	std::size_t j = 0;
+
+	for (std::size_t i = 0; i < size; i++) {
+		if (i == pos) {
+			copy->keys()[j] = c;
+			copy->children()[j++] = child;
+			if (replace)
+				continue;
+		}
+		copy->keys()[j] = b->keys()[i];
+		copy->children()[j++] = b->children()[i];
+	}
+	if (pos == size) {
+		copy->keys()[j] = c;
+		copy->children()[j] = child;
+	}
+
+	return copy;
+}
+
+template<typename K, typename T>
+typename concurrent_radix_tree<K, T>::block* concurrent_radix_tree<K, T>::block_without(block* b, unsigned char c)
+{
+	if (b->m_size == 1)
+		return NULL;
+
+	block* copy = make_block(b->m_size - 1);
+	std::size_t j = 0;
+
+	for (std::size_t i = 0; i < b->m_size; i++) {
+		if (b->keys()[i] == c)
+			continue;
+		copy->keys()[j] = b->keys()[i];
+		copy->children()[j++] = b->children()[i];
+	}
+
+	return copy;
+}
+
+template<typename K, typename T>
+bool concurrent_radix_tree<K, T>::find(const char* key, int len, T& value) const
+{
+	radix_tree_epoch::guard guard(m_epoch);
+
+restart:
+	node* n = m_root;
+	std::uint64_t version;
+	int depth = 0;
+
+	if (!read_lock(n, version))
+		goto restart;
+
+	while (depth != len) {
+		node* child = block_find(n->m_children.load(std::memory_order_acquire), static_cast<unsigned char>(key[depth]));
+		if (!check(n, version))
+			goto restart;
+		// labels never change, a mismatch is final as long as the child was reached consistently
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			return false;
+
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version) || !check(n, version))
+			goto restart;
+
+		n = child;
+		version = child_version;
+		depth += child->m_key_len;
+	}
+
+	value_type* val = n->m_value.load(std::memory_order_acquire);
+	if (!check(n, version))
+		goto restart;
+	if (val == NULL)
+		return false;
+
+	value = val->second;
+
+	return true;
+}
+
+template<typename K, typename T>
+bool concurrent_radix_tree<K, T>::longest_match(const char* key, int len, K& match, T& value) const
+{
+	radix_tree_epoch::guard guard(m_epoch);
+
+restart:
+	node* n = m_root;
+	std::uint64_t version;
+	int depth = 0;
+	// stays alive until the guard is gone, its contents never change
+	value_type* best = NULL;
+
+	if (!read_lock(n, version))
+		goto restart;
+
+	for (;;) {
+		value_type* val = n->m_value.load(std::memory_order_acquire);
+		node* child = depth != len ? block_find(n->m_children.load(std::memory_order_acquire), static_cast<unsigned char>(key[depth])) : NULL;
+		if (!check(n, version))
+			goto restart;
+		if (val != NULL)
+			best = val;
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			break;
+
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version) || !check(n, version))
+			goto restart;
+
+		n = child;
+		version = child_version;
+		depth += child->m_key_len;
+	}
+
+	if (best == NULL)
+		return false;
+
+	match = best->first;
+	value = best->second;
+
+	return true;
+}
+
+template<typename K, typename T>
+void concurrent_radix_tree<K, T>::prefix_match(const char* key, int len, std::vector<value_type>& vec) const
+{
+	radix_tree_epoch::guard guard(m_epoch);
+	// every node read with the version it was read at; the result is returned only if none of them changed
+	std::vector<std::pair<node*, std::uint64_t> > seen;
+	std::vector<node*> stack;
+
+restart:
+	vec.clear();
+	seen.clear();
+	stack.clear();
+
+	node* n = m_root;
+	std::uint64_t version;
+	int depth = 0;
+
+	if (!read_lock(n, version))
+		goto restart;
+
+	while (depth != len) {
+		node* child = block_find(n->m_children.load(std::memory_order_acquire), static_cast<unsigned char>(key[depth]));
+		if (!check(n, version))
+			goto restart;
+
+		int rest = len - depth;
+		if (child == NULL || !radix_equal(key + depth, child->key(), child->m_key_len < rest ? child->m_key_len : rest))
+			return;
+
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version) || !check(n, version))
+			goto restart;
+
+		seen.push_back(std::make_pair(n, version));
+		n = child;
+		version = child_version;
+		// the key may end inside the child's label, the whole subtree of the child matches then
+		depth += child->m_key_len < rest ? child->m_key_len : rest;
+	}
+
+	// pre-order over the subtree, children in byte order, which is key order
+	stack.push_back(n);
+	while (!stack.empty()) {
+		n = stack.back();
+		stack.pop_back();
+		if (!read_lock(n, version))
+			goto restart;
+
+		value_type* val = n->m_value.load(std::memory_order_acquire);
+		block* b = n->m_children.load(std::memory_order_acquire);
+		if (!check(n, version))
+			goto restart;
+
+		seen.push_back(std::make_pair(n, version));
+		if (val != NULL)
+			vec.push_back(*val);
+		if (b != NULL) {
+			for (std::size_t i = b->m_size; i-- > 0; )
+				stack.push_back(b->children()[i]);
+		}
+	}
+
+	for (std::size_t i = 0; i < seen.size(); i++) {
+		if (!check(seen[i].first, seen[i].second))
+			goto restart;
+	}
+}
+
+template<typename K, typename T>
+bool concurrent_radix_tree<K, T>::insert(const value_type& val)
+{
+	radix_tree_epoch::guard guard(m_epoch);
+	const char* key = radix_data(val.first);
+	int len = radix_length(val.first);
+	// kept over restarts, the node holding it is built again
+	draft d;
+
+restart:
+	node* n = m_root;
+	std::uint64_t version;
+	int depth = 0;
+
+	if (!read_lock(n, version))
+		goto restart;
+
+	while (depth != len) {
+		block* b = n->m_children.load(std::memory_order_acquire);
+		node* child = block_find(b, static_cast<unsigned char>(key[depth]));
+		if (!check(n, version))
+			goto restart;
+
+		if (child == NULL) {
+			// a new leaf under n
+			node* leaf = d.add(make_node(depth, key + depth, len - depth, NULL, d.value(val)));
+			block* grown = d.add(block_with(b, leaf));
+			if (!upgrade(n, version)) {
+				d.discard();
+				goto restart;
+			}
+			n->m_children.store(grown, std::memory_order_release);
+			unlock(n);
+			d.publish();
+			if (b != NULL)
+				guard.retire(b, free_block);
+			m_size.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		int rest = len - depth;
+		int count = radix_mismatch(key + depth, child->key(), child->m_key_len < rest ? child->m_key_len : rest);
+
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version))
+			goto restart;
+
+		if (count == child->m_key_len) {
+			if (!check(n, version))
+				goto restart;
+			n = child;
+			version = child_version;
+			depth += count;
+			continue;
+		}
+
+		// the key leaves the child's label after count bytes: the child is replaced by a node with the
+		// common part of the label, holding a copy of the child with the rest of the label and the new key;
+		// what is read of the child here is only used once upgrading it shows it has not changed
+		node* lower = d.add(make_node(depth + count, child->key() + count, child->m_key_len - count,
+			child->m_children.load(std::memory_order_acquire), child->m_value.load(std::memory_order_acquire)));
+		block* single = d.add(block_with(NULL, lower));
+		block* split = single;
+		value_type* split_value = NULL;
+
+		if (count == rest)
+			split_value = d.value(val);
+		else
+			split = d.add(block_with(single, d.add(make_node(depth + count, key + depth + count, rest - count, NULL, d.value(val)))));
+
+		node* upper = d.add(make_node(depth, key + depth, count, split, split_value));
+		block* grown = d.add(block_with(b, upper));
+
+		if (!upgrade(n, version)) {
+			d.discard();
+			goto restart;
+		}
+		if (!upgrade(child, child_version)) {
+			unlock(n);
+			d.discard();
+			goto restart;
+		}
+
+		n->m_children.store(grown, std::memory_order_release);
+		unlock_obsolete(child);
+		unlock(n);
+		d.publish();
+		if (split != single)
+			free_block(single);
+		// the child's children and value now belong to lower, only the node itself goes
+		guard.retire(child, free_node);
+		guard.retire(b, free_block);
+		m_size.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// upgrading proves the value read here is still the current one
+	if (n->m_value.load(std::memory_order_acquire) != NULL) {
+		if (!check(n, version))
+			goto restart;
+		return false;
+	}
+	value_type* fresh = d.value(val);
+	if (!upgrade(n, version))
+		goto restart;
+	n->m_value.store(fresh, std::memory_order_release);
+	unlock(n);
+	d.publish();
+	m_size.fetch_add(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+template<typename K, typename T>
+bool concurrent_radix_tree<K, T>::erase(const char* key, int len)
+{
+	radix_tree_epoch::guard guard(m_epoch);
+	draft d;
+
+restart:
+	node* grand = NULL;
+	node* parent = NULL;
+	node* n = m_root;
+	std::uint64_t grand_version = 0, parent_version = 0, version;
+	int depth = 0;
+
+	if (!read_lock(n, version))
+		goto restart;
+
+	while (depth != len) {
+		node* child = block_find(n->m_children.load(std::memory_order_acquire), static_cast<unsigned char>(key[depth]));
+		if (!check(n, version))
+			goto restart;
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			return false;
+
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version) || !check(n, version))
+			goto restart;
+
+		grand = parent;
+		grand_version = parent_version;
+		parent = n;
+		parent_version = version;
+		n = child;
+		version = child_version;
+		depth += child->m_key_len;
+	}
+
+	value_type* val = n->m_value.load(std::memory_order_acquire);
+	block* b = n->m_children.load(std::memory_order_acquire);
+	if (!check(n, version))
+		goto restart;
+	if (val == NULL)
+		return false;
+
+	if (n == m_root || (b != NULL && b->m_size >= 2)) {
+		// n stays as a branch
+		if (!upgrade(n, version))
+			goto restart;
+		n->m_value.store(NULL, std::memory_order_release);
+		unlock(n);
+		guard.retire(val, free_value);
+	}
+	else if (b != NULL) {
+		// a single child is left: n and the child merge into one node in n's place
+		node* child = b->children()[0];
+		std::uint64_t child_version;
+		if (!read_lock(child, child_version))
+			goto restart;
+		block* pb = parent->m_children.load(std::memory_order_acquire);
+		if (!check(parent, parent_version))
+			goto restart;
+
+		// built from what the upgrades below show to be unchanged
+		node* merged = d.add(make_node(n->m_depth, n->key(), n->m_key_len, child->key(), child->m_key_len,
+			child->m_children.load(std::memory_order_acquire), child->m_value.load(std::memory_order_acquire)));
+		block* replaced = d.add(block_with(pb, merged));
+		if (!upgrade(parent, parent_version)) {
+			d.discard();
+			goto restart;
+		}
+		if (!upgrade(n, version)) {
+			unlock(parent);
+			d.discard();
+			goto restart;
+		}
+		if (!upgrade(child, child_version)) {
+			unlock(n);
+			unlock(parent);
+			d.discard();
+			goto restart;
+		}
+
+		parent->m_children.store(replaced, std::memory_order_release);
+		unlock_obsolete(child);
+		unlock_obsolete(n);
+		unlock(parent);
+		d.publish();
+		guard.retire(pb, free_block);
+		guard.retire(b, free_block);
+		guard.retire(n, free_node);
+		guard.retire(child, free_node);
+		guard.retire(val, free_value);
+	}
+	else {
+		// n is a leaf and goes; a parent left without a value and with one child merges with that child
+		block* pb = parent->m_children.load(std::memory_order_acquire);
+		value_type* parent_val = parent->m_value.load(std::memory_order_acquire);
+		if (!check(parent, parent_version))
+			goto restart;
+
+		if (parent != m_root && parent_val == NULL && pb->m_size == 2) {
+			node* sibling = pb->children()[pb->children()[0] == n ? 1 : 0];
+			std::uint64_t sibling_version;
+			if (!read_lock(sibling, sibling_version))
+				goto restart;
+			block* gb = grand->m_children.load(std::memory_order_acquire);
+			if (!check(grand, grand_version))
+				goto restart;
+
+			node* merged = d.add(make_node(parent->m_depth, parent->key(), parent->m_key_len, sibling->key(), sibling->m_key_len,
+				sibling->m_children.load(std::memory_order_acquire), sibling->m_value.load(std::memory_order_acquire)));
+			block* replaced = d.add(block_with(gb, merged));
+			if (!upgrade(grand, grand_version)) {
+				d.discard();
+				goto restart;
+			}
+			if (!upgrade(parent, parent_version)) {
+				unlock(grand);
+				d.discard();
+				goto restart;
+			}
+			if (!upgrade(n, version)) {
+				unlock(parent);
+				unlock(grand);
+				d.discard();
+				goto restart;
+			}
+			if (!upgrade(sibling, sibling_version)) {
+				unlock(n);
+				unlock(parent);
+				unlock(grand);
+				d.discard();
+				goto restart;
+			}
+
+			grand->m_children.store(replaced, std::memory_order_release);
+			unlock_obsolete(sibling);
+			unlock_obsolete(n);
+			unlock_obsolete(parent);
+			unlock(grand);
+			d.publish();
+			guard.retire(gb, free_block);
+			guard.retire(pb, free_block);
+			guard.retire(parent, free_node);
+			guard.retire(sibling, free_node);
+		}
+		else {
+			block* shrunk = d.add(block_without(pb, n->edge()));
+			if (!upgrade(parent, parent_version)) {
+				d.discard();
+				goto restart;
+			}
+			if (!upgrade(n, version)) {
+				unlock(parent);
+				d.discard();
+				goto restart;
+			}
+			parent->m_children.store(shrunk, std::memory_order_release);
+			unlock_obsolete(n);
+			unlock(parent);
+			d.publish();
+			guard.retire(pb, free_block);
+		}
+		guard.retire(n, free_node);
+		guard.retire(val, free_value);
+	}
+
+	m_size.fetch_sub(1, std::memory_order_relaxed);
+
+	return true;
+}
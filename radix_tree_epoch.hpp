@@ -0,0 +1,143 @@
+#pragma once
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<functional>
+#include<thread>
+#include<vector>
+
+// Epoch based reclamation for structures read without locks. Every operation runs
+// inside a guard, which occupies one of a fixed number of slots and publishes the
+// global epoch it started in. Memory unlinked by a writer is retired into the
+// slot's list tagged with the current epoch, and freed once the global epoch has
+// moved two steps past it: the epoch only advances when every running operation
+// has seen the current one, so by then nothing that could still hold the pointer
+// is running. The retire list belongs to the slot rather than to a thread, which
+// needs neither thread registration nor a lock; whoever holds the slot next
+// carries on reclaiming it.
+class radix_tree_epoch {
+	struct slot;
+public:
+	radix_tree_epoch();
+	~radix_tree_epoch();
+
+	class guard {
+	public:
+		explicit guard(radix_tree_epoch& epoch);
+		~guard();
+		// p is handed to deleter once no operation that might still see it is running
+		void retire(void* p, void (*deleter)(void*));
+	private:
+		guard(const guard&);
+		guard& operator=(const guard&);
+
+		radix_tree_epoch& m_epoch;
+		slot* m_slot;
+	};
+private:
+	enum { slots = 64, reclaim_every = 64 };
+	struct retired {
+		void* p;
+		void (*deleter)(void*);
+		std::uint64_t epoch;
+	};
+	struct alignas(64) slot {
+		std::atomic<bool> busy;
+		// epoch the current operation started in, 0 while the slot is free
+		std::atomic<std::uint64_t> epoch;
+		std::vector<retired> garbage;
+	};
+
+	radix_tree_epoch(const radix_tree_epoch&);
+	radix_tree_epoch& operator=(const radix_tree_epoch&);
+
+	slot* acquire();
+	void release(slot* s);
+	void reclaim(slot* s);
+
+	std::atomic<std::uint64_t> m_global;
+	slot m_slots[slots];
+};
+
+inline radix_tree_epoch::radix_tree_epoch() :m_global(1)
+{
+	for (int i = 0; i < slots; i++) {
+		m_slots[i].busy.store(false, std::memory_order_relaxed);
+		m_slots[i].epoch.store(0, std::memory_order_relaxed);
+	}
+}
+
+inline radix_tree_epoch::~radix_tree_epoch()
+{
+	for (int i = 0; i < slots; i++) {
+		std::vector<retired>& garbage = m_slots[i].garbage;
+		for (std::size_t j = 0; j < garbage.size(); j++)
+			garbage[j].deleter(garbage[j].p);
+	}
+}
+
+inline radix_tree_epoch::slot* radix_tree_epoch::acquire()
+{
+	// start probing at a slot picked by the thread id so that threads mostly keep to their own slot
+	std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+	for (std::size_t i = 0; ; i++) {
+		slot* s = &m_slots[(start + i) % slots];
+		if (!s->busy.load(std::memory_order_relaxed) && !s->busy.exchange(true, std::memory_order_acquire)) {
+			s->epoch.store(m_global.load());
+			// the loads of the structure below must not be performed before the epoch is visible
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return s;
+		}
+		if (i % slots == slots - 1)
+			std::this_thread::yield();
+	}
+}
+
+inline void radix_tree_epoch::release(slot* s)
+{
+	s->epoch.store(0, std::memory_order_release);
+	s->busy.store(false, std::memory_order_release);
+}
+
+inline void radix_tree_epoch::reclaim(slot* s)
+{
+	std::uint64_t global = m_global.load();
+	bool current = true;
+
+	for (int i = 0; i < slots && current; i++) {
+		std::uint64_t epoch = m_slots[i].epoch.load();
+		current = epoch == 0 || epoch == global;
+	}
+	if (current)
+		m_global.compare_exchange_strong(global, global + 1);
+	global = m_global.load();
+
+	std::vector<retired>& garbage = s->garbage;
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < garbage.size(); i++) {
+		if (garbage[i].epoch + 2 <= global)
+			garbage[i].deleter(garbage[i].p);
+		else
+			garbage[kept++] = garbage[i];
+	}
+	garbage.resize(kept);
+}
+
+inline radix_tree_epoch::guard::guard(radix_tree_epoch& epoch) :m_epoch(epoch), m_slot(epoch.acquire())
+{
+}
+
+inline radix_tree_epoch::guard::~guard()
+{
+	m_epoch.release(m_slot);
+}
+
+inline void radix_tree_epoch::guard::retire(void* p, void (*deleter)(void*))
+{
+	retired r = { p, deleter, m_epoch.m_global.load() };
+
+	m_slot->garbage.push_back(r);
+	if (m_slot->garbage.size() % reclaim_every == 0)
+		m_epoch.reclaim(m_slot);
+}
@@ -0,0 +1,348 @@
+#pragma once
+#include<cstddef>
+#include<string>
+#include<utility>
+#include<vector>
+
+#include "radix_tree.hpp"
+#include "radix_tree_bits.hpp"
+
+// Read-only radix tree in a succinct, pointer-free layout, for dictionaries that
+// are built once and then only queried. The nodes are numbered breadth first and
+// kept in a few flat arrays:
+//
+//   louds   for every node one 1 per child followed by a 0; the children of
+//           node x are the ones after the x-th zero, so their numbers and
+//           count come from select0 without storing any pointer
+//   edges   first byte of every node's edge label, sorted among siblings
+//   tails   the rest of each label, back to back in one byte array; node x's
+//           tail is where the run of zeros after the x-th one in tail_bits is
+//   values  the values of the nodes with has_value set, a dense array indexed
+//           by rank1 over has_value
+//
+// A node costs about four bits, its first label byte and the bytes of its tail,
+// against a pointer-linked node with its child index, parent, depth and label
+// pointer in the mutable tree. Lookups walk the same path as radix_tree::find,
+// with a select0 for the children and a select1 for the label tail at every
+// level. Keys of results are rebuilt from the labels on the way down, so K must
+// be constructible from a pointer and a length, as std::string is.
+template<typename K, typename T>
+class frozen_radix_tree {
+public:
+	typedef K key_type;
+	typedef T mapped_type;
+	typedef std::pair<const K, T> value_type;
+	typedef std::size_t size_type;
+
+	frozen_radix_tree() :m_size(0) { freeze_sorted(std::vector<std::pair<const char*, int> >(), std::vector<const T*>()); }
+	template<class Compare>
+	explicit frozen_radix_tree(const radix_tree<K, T, Compare>& tree) :m_size(0) { freeze(tree); }
+
+	// replaces the contents with those of tree; throws std::length_error, keeping
+	// the old contents, when a bit vector would pass radix_bit_vector::max_bits,
+	// that is past about 2^31 nodes or 2^32 bytes of labels
+	template<class Compare> void freeze(const radix_tree<K, T, Compare>& tree);
+
+	size_type size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	// memory held by the arrays
+	size_type bytes() const;
+
+	// the value stored under key, NULL when there is none
+	const T* find(const K& key) const { return find(radix_data(key), radix_length(key)); }
+	const T* find(const char* key, int len) const;
+	// the value of the longest stored key that is a prefix of key, which goes to match
+	const T* longest_match(const K& key, K& match) const;
+	const T* longest_match(const char* key, int len, int& match_len) const;
+	// copies of the elements whose key starts with key, in key order
+	void prefix_match(const K& key, std::vector<value_type>& vec, size_type limit = size_type(-1)) const { prefix_match(radix_data(key), radix_length(key), vec, limit); }
+	void prefix_match(const char* key, int len, std::vector<value_type>& vec, size_type limit = size_type(-1)) const;
+	// calls visit on those elements in key order until it returns false, returns the number visited
+	template<class Visitor> size_type for_each_prefix_match(const char* key, int len, Visitor visit) const;
+	template<class Visitor> size_type for_each(Visitor visit) const { return for_each_prefix_match("", 0, visit); }
+private:
+	typedef std::size_t node_id;
+	static const node_id npos = node_id(-1);
+
+	// builds the arrays from the keys in ascending order and their values
+	void freeze_sorted(const std::vector<std::pair<const char*, int> >& keys, const std::vector<const T*>& values);
+	// the child of x whose label starts with byte, npos when there is none
+	node_id child(node_id x, unsigned char byte) const;
+	// number of the first child of x and the number of children
+	void children(node_id x, node_id& first, std::size_t& count) const;
+	// position and length of the tail of x in m_tails
+	void tail(node_id x, std::size_t& begin, int& len) const;
+	const T* value(node_id x) const { return m_has_value[x] ? &m_values[m_has_value.rank1(x)] : NULL; }
+
+	size_type m_size;
+	radix_bit_vector m_louds;
+	radix_bit_vector m_tail_bits;
+	radix_bit_vector m_has_value;
+	std::vector<unsigned char> m_edges;
+	std::vector<char> m_tails;
+	std::vector<T> m_values;
+};
+
+template<typename K, typename T>
+template<class Compare>
+void frozen_radix_tree<K, T>::freeze(const radix_tree<K, T, Compare>& tree)
+{
+	std::vector<std::pair<const char*, int> > keys;
+	std::vector<const T*> values;
+
+	keys.reserve(tree.size());
+	values.reserve(tree.size());
+	for (typename radix_tree<K, T, Compare>::const_iterator it = tree.begin(); it != tree.end(); ++it) {
+		keys.push_back(std::make_pair(radix_data(it->first), radix_length(it->first)));
+		values.push_back(&it->second);
+	}
+
+	// laid out aside, so that a throw leaves this one as it was
+	frozen_radix_tree next;
+	next.freeze_sorted(keys, values);
+	*this = std::move(next);
+}
+
+template<typename K, typename T>
+void frozen_radix_tree<K, T>::freeze_sorted(const std::vector<std::pair<const char*, int> >& keys, const std::vector<const T*>& values)
+{
+	// a node to be laid out: the keys [lo, hi) below it, which agree on their first depth bytes
+	struct pending {
+		std::size_t lo, hi;
+		int depth;
+	};
+	std::vector<pending> queue;
+
+	m_size = keys.size();
+	m_louds = radix_bit_vector();
+	m_tail_bits = radix_bit_vector();
+	m_has_value = radix_bit_vector();
+	m_edges.clear();
+	m_tails.clear();
+	m_values.clear();
+	m_values.reserve(keys.size());
+
+	// the root has an empty label, every other node's label starts with its edge byte
+	pending root = { 0, keys.size(), 0 };
+	queue.push_back(root);
+	m_edges.push_back(0);
+	for (std::size_t i = 0; i < queue.size(); i++) {
+		pending p = queue[i];
+		int end = p.depth;
+		if (i != 0) {
+			// the keys are sorted, so the common prefix of the run is that of its first and last key
+			const std::pair<const char*, int>& a = keys[p.lo];
+			const std::pair<const char*, int>& b = keys[p.hi - 1];
+			int n = (a.second < b.second ? a.second : b.second) - p.depth;
+			end = p.depth + radix_mismatch(a.first + p.depth, b.first + p.depth, n);
+			m_tails.insert(m_tails.end(), a.first + p.depth + 1, a.first + end);
+		}
+		m_tail_bits.push_back(true);
+		for (int j = p.depth + (i != 0 ? 1 : 0); j < end; j++)
+			m_tail_bits.push_back(false);
+
+		std::size_t lo = p.lo;
+		bool has_value = lo < p.hi && keys[lo].second == end;
+		m_has_value.push_back(has_value);
+		if (has_value)
+			m_values.push_back(*values[lo++]);
+
+		while (lo < p.hi) {
+			unsigned char byte = static_cast<unsigned char>(keys[lo].first[end]);
+			pending c = { lo, lo, end };
+			while (c.hi < p.hi && static_cast<unsigned char>(keys[c.hi].first[end]) == byte)
+				c.hi++;
+			queue.push_back(c);
+			m_edges.push_back(byte);
+			m_louds.push_back(true);
+			lo = c.hi;
+		}
+		m_louds.push_back(false);
+	}
+	// closes the tail of the last node
+	m_tail_bits.push_back(true);
+
+	m_louds.build();
+	m_tail_bits.build();
+	m_has_value.build();
+	std::vector<unsigned char>(m_edges).swap(m_edges);
+	std::vector<char>(m_tails).swap(m_tails);
+}
+
+template<typename K, typename T>
+typename frozen_radix_tree<K, T>::size_type frozen_radix_tree<K, T>::bytes() const
+{
+	return sizeof(*this) + m_louds.bytes() + m_tail_bits.bytes() + m_has_value.bytes()
+		+ m_edges.capacity() + m_tails.capacity() + m_values.capacity() * sizeof(T);
+}
+
+template<typename K, typename T>
+void frozen_radix_tree<K, T>::children(node_id x, node_id& first, std::size_t& count) const
+{
+	// x zeros come before the children of x and each one before them is a node numbered after the root
+	std::size_t begin = x == 0 ? 0 : m_louds.select0(x - 1) + 1;
+
+	first = begin - x + 1;
+	count = m_louds.next0(begin) - begin;
+}
+
+template<typename K, typename T>
+typename frozen_radix_tree<K, T>::node_id frozen_radix_tree<K, T>::child(node_id x, unsigned char byte) const
+{
+	node_id lo;
+	std::size_t count;
+
+	children(x, lo, count);
+
+	node_id last = lo + count;
+	node_id hi = last;
+	while (lo < hi) {
+		node_id mid = lo + (hi - lo) / 2;
+		if (m_edges[mid] < byte)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < last && m_edges[lo] == byte ? lo : npos;
+}
+
+template<typename K, typename T>
+void frozen_radix_tree<K, T>::tail(node_id x, std::size_t& begin, int& len) const
+{
+	std::size_t pos = m_tail_bits.select1(x);
+
+	begin = pos - x;
+	len = static_cast<int>(m_tail_bits.next1(pos + 1) - pos - 1);
+}
+
+template<typename K, typename T>
+const T* frozen_radix_tree<K, T>::find(const char* key, int len) const
+{
+	node_id x = 0;
+
+	for (int pos = 0; pos < len; ) {
+		x = child(x, static_cast<unsigned char>(key[pos]));
+		if (x == npos)
+			return NULL;
+
+		std::size_t begin;
+		int tail_len;
+		tail(x, begin, tail_len);
+		if (len - pos - 1 < tail_len || (tail_len != 0 && !radix_equal(key + pos + 1, m_tails.data() + begin, tail_len)))
+			return NULL;
+		pos += 1 + tail_len;
+	}
+
+	return value(x);
+}
+
+template<typename K, typename T>
+const T* frozen_radix_tree<K, T>::longest_match(const char* key, int len, int& match_len) const
+{
+	node_id x = 0;
+	const T* best = value(0);
+
+	match_len = 0;
+	for (int pos = 0; pos < len; ) {
+		x = child(x, static_cast<unsigned char>(key[pos]));
+		if (x == npos)
+			break;
+
+		std::size_t begin;
+		int tail_len;
+		tail(x, begin, tail_len);
+		if (len - pos - 1 < tail_len || (tail_len != 0 && !radix_equal(key + pos + 1, m_tails.data() + begin, tail_len)))
+			break;
+		pos += 1 + tail_len;
+		if (m_has_value[x]) {
+			best = value(x);
+			match_len = pos;
+		}
+	}
+
+	return best;
+}
+
+template<typename K, typename T>
+const T* frozen_radix_tree<K, T>::longest_match(const K& key, K& match) const
+{
+	int len;
+	const T* found = longest_match(radix_data(key), radix_length(key), len);
+
+	if (found != NULL)
+		match = K(radix_data(key), len);
+
+	return found;
+}
+
+template<typename K, typename T>
+void frozen_radix_tree<K, T>::prefix_match(const char* key, int len, std::vector<value_type>& vec, size_type limit) const
+{
+	vec.clear();
+	if (limit == 0)
+		return;
+
+	for_each_prefix_match(key, len, [&vec, limit](const value_type& val) {
+		vec.push_back(val);
+		return vec.size() < limit;
+	});
+}
+
+template<typename K, typename T>
+template<class Visitor>
+typename frozen_radix_tree<K, T>::size_type frozen_radix_tree<K, T>::for_each_prefix_match(const char* key, int len, Visitor visit) const
+{
+	// walks down to the node whose subtree holds the keys starting with key, collecting its full key
+	std::string path;
+	node_id x = 0;
+
+	for (int pos = 0; pos < len; ) {
+		x = child(x, static_cast<unsigned char>(key[pos]));
+		if (x == npos)
+			return 0;
+
+		std::size_t begin;
+		int tail_len;
+		tail(x, begin, tail_len);
+		// the key may end inside the label, the label must then start with the rest of the key
+		int n = len - pos - 1 < tail_len ? len - pos - 1 : tail_len;
+		if (n != 0 && !radix_equal(key + pos + 1, m_tails.data() + begin, n))
+			return 0;
+		path.push_back(key[pos]);
+		path.append(m_tails.data() + begin, tail_len);
+		pos += 1 + tail_len;
+	}
+
+	// depth first in key order; each entry is a node and the length of the path above its label
+	std::vector<std::pair<node_id, std::size_t> > stack;
+	size_type count = 0;
+
+	stack.push_back(std::make_pair(x, path.size()));
+	for (bool first = true; !stack.empty(); first = false) {
+		node_id y = stack.back().first;
+		path.resize(stack.back().second);
+		stack.pop_back();
+		if (!first) {
+			std::size_t begin;
+			int tail_len;
+			tail(y, begin, tail_len);
+			path.push_back(static_cast<char>(m_edges[y]));
+			path.append(m_tails.data() + begin, tail_len);
+		}
+
+		if (m_has_value[y]) {
+			count++;
+			if (!visit(value_type(K(path.data(), path.size()), *value(y))))
+				break;
+		}
+
+		node_id c;
+		std::size_t n;
+		children(y, c, n);
+		for (std::size_t j = n; j != 0; j--)
+			stack.push_back(std::make_pair(c + j - 1, path.size()));
+	}
+
+	return count;
+}
@@ -0,0 +1,483 @@
+#pragma once
+#include<cstddef>
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<iterator>
+#include<type_traits>
+#include<utility>
+#include<vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+#include "radix_tree.hpp"
+
+// A radix_tree written out as one position-independent block that a process can
+// map and search in place. Every part of the image is a flat array addressed by
+// offsets from the start of the image:
+//
+//   header   counts and the offset of each array below
+//   nodes    the trie in breadth-first order, so the children of a node are
+//            consecutive and sorted by their first byte
+//   edges    first byte of each node's edge label, searched when descending
+//   offsets  record i's key is keys[offsets[i], offsets[i + 1])
+//   values   record i's value, a copy of the tree's T
+//   keys     every key in key order, back to back
+//
+// Records are the elements in key order, so ordered iteration walks the arrays
+// and the elements below a node are the records [first, last). A node stores no
+// label of its own: its label is bytes [depth, depth + label_len) of the key of
+// record first, and the node holds that key when the key ends exactly there.
+// Values are copied bytewise, so T must be trivially copyable. Node fields are
+// 32 bits wide, so an image holds fewer than 2^32 records and nodes; depths and
+// label lengths fit since keys are at most INT_MAX bytes long. The image uses the
+// byte order and word size of the machine that wrote it; the header records them
+// and a view refuses an image it cannot read.
+struct radix_tree_image_header {
+	char magic[8];
+	std::uint32_t byte_order;
+	std::uint32_t version;
+	std::uint32_t value_size;
+	std::uint32_t value_align;
+	std::uint64_t node_count;
+	std::uint64_t record_count;
+	std::uint64_t nodes;
+	std::uint64_t edges;
+	std::uint64_t offsets;
+	std::uint64_t values;
+	std::uint64_t keys;
+	std::uint64_t size;
+};
+
+struct radix_tree_image_node {
+	std::uint32_t depth;
+	std::uint32_t label_len;
+	std::uint32_t first_child;
+	std::uint32_t child_count;
+	// records [first, last) have keys in this subtree
+	std::uint32_t first;
+	std::uint32_t last;
+};
+
+static const char radix_tree_image_magic[8] = { 'R', 'A', 'D', 'I', 'X', 'I', 'M', 'G' };
+enum { radix_tree_image_version = 1 };
+// records and nodes are indexed by the 32-bit fields of radix_tree_image_node
+static const std::uint64_t radix_tree_image_max_count = 0xFFFFFFFFu;
+
+inline std::uint64_t radix_image_align(std::uint64_t offset, std::uint64_t align)
+{
+	return (offset + align - 1) / align * align;
+}
+
+// serializes tree into image, replacing its contents; false, with image left empty,
+// when the tree has too many keys or nodes for the 32-bit fields of the nodes
+template<typename K, typename T, typename Compare>
+bool radix_tree_write_image(const radix_tree<K, T, Compare>& tree, std::vector<char>& image)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "values are copied into the image bytewise");
+
+	typedef typename radix_tree<K, T, Compare>::const_iterator const_iterator;
+	std::vector<const_iterator> records;
+	std::vector<std::uint64_t> offsets(1, 0);
+
+	image.clear();
+	if (tree.size() > radix_tree_image_max_count)
+		return false;
+
+	records.reserve(tree.size());
+	for (const_iterator it = tree.begin(); it != tree.end(); ++it) {
+		records.push_back(it);
+		offsets.push_back(offsets.back() + radix_length(it->first));
+	}
+
+	// breadth first: a node's children are appended together while it is processed, so they are consecutive
+	std::vector<radix_tree_image_node> nodes;
+	std::vector<unsigned char> edges;
+	if (!records.empty()) {
+		radix_tree_image_node root = { 0, 0, 0, 0, 0, static_cast<std::uint32_t>(records.size()) };
+		nodes.push_back(root);
+		edges.push_back(0);
+	}
+	for (std::size_t i = 0; i < nodes.size(); i++) {
+		std::uint32_t lo = nodes[i].first, hi = nodes[i].last;
+		const char* a = radix_data(records[lo]->first);
+		const char* b = radix_data(records[hi - 1]->first);
+		int depth = static_cast<int>(nodes[i].depth);
+		int len_a = radix_length(records[lo]->first);
+		int len_b = radix_length(records[hi - 1]->first);
+		int n = (len_a < len_b ? len_a : len_b) - depth;
+		// the records are sorted, so the common prefix of the run is that of its first and last key
+		int end = depth + radix_mismatch(a + depth, b + depth, n);
+
+		nodes[i].label_len = static_cast<std::uint32_t>(end - depth);
+		nodes[i].first_child = static_cast<std::uint32_t>(nodes.size());
+		if (len_a == end)
+			lo++;
+		while (lo < hi) {
+			unsigned char byte = static_cast<unsigned char>(radix_data(records[lo]->first)[end]);
+			std::uint32_t run = lo;
+			while (lo < hi && static_cast<unsigned char>(radix_data(records[lo]->first)[end]) == byte)
+				lo++;
+			if (nodes.size() == radix_tree_image_max_count)
+				return false;
+			radix_tree_image_node child = { static_cast<std::uint32_t>(end), 0, 0, 0, run, lo };
+			nodes.push_back(child);
+			edges.push_back(byte);
+		}
+		nodes[i].child_count = static_cast<std::uint32_t>(nodes.size() - nodes[i].first_child);
+	}
+
+	std::uint64_t value_align = std::alignment_of<T>::value > 8 ? std::alignment_of<T>::value : 8;
+	radix_tree_image_header header;
+	std::memcpy(header.magic, radix_tree_image_magic, sizeof(header.magic));
+	header.byte_order = 0x01020304;
+	header.version = radix_tree_image_version;
+	header.value_size = sizeof(T);
+	header.value_align = static_cast<std::uint32_t>(value_align);
+	header.node_count = nodes.size();
+	header.record_count = records.size();
+	header.nodes = radix_image_align(sizeof(header), 8);
+	header.edges = header.nodes + nodes.size() * sizeof(radix_tree_image_node);
+	header.offsets = radix_image_align(header.edges + edges.size(), 8);
+	header.values = radix_image_align(header.offsets + offsets.size() * sizeof(std::uint64_t), value_align);
+	header.keys = header.values + records.size() * sizeof(T);
+	header.size = header.keys + offsets.back();
+
+	image.assign(static_cast<std::size_t>(header.size), 0);
+	std::memcpy(&image[0], &header, sizeof(header));
+	if (!nodes.empty())
+		std::memcpy(&image[static_cast<std::size_t>(header.nodes)], &nodes[0], nodes.size() * sizeof(radix_tree_image_node));
+	if (!edges.empty())
+		std::memcpy(&image[static_cast<std::size_t>(header.edges)], &edges[0], edges.size());
+	std::memcpy(&image[static_cast<std::size_t>(header.offsets)], &offsets[0], offsets.size() * sizeof(std::uint64_t));
+	for (std::size_t i = 0; i < records.size(); i++) {
+		std::memcpy(&image[static_cast<std::size_t>(header.values + i * sizeof(T))], &records[i]->second, sizeof(T));
+		int len = radix_length(records[i]->first);
+		if (len != 0)
+			std::memcpy(&image[static_cast<std::size_t>(header.keys + offsets[i])], radix_data(records[i]->first), len);
+	}
+
+	return true;
+}
+
+// writes the image of tree to the file path, false when the tree does not fit in an
+// image or the file cannot be written
+template<typename K, typename T, typename Compare>
+bool radix_tree_save(const radix_tree<K, T, Compare>& tree, const char* path)
+{
+	std::vector<char> image;
+	if (!radix_tree_write_image(tree, image))
+		return false;
+
+	std::FILE* file = std::fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	bool ok = std::fwrite(&image[0], 1, image.size(), file) == image.size();
+
+	return std::fclose(file) == 0 && ok;
+}
+
+// Read-only radix tree over an image written by radix_tree_write_image or
+// radix_tree_save. open() maps the file and only checks the header, so it costs
+// the same whatever the size of the tree; lookups and iteration read the mapped
+// pages directly and several processes mapping one file share the page cache.
+// The image is trusted: open() does not walk the nodes, so a corrupt file can
+// make lookups read out of bounds. Keys are returned as pointers into the image
+// and stay valid until the view is closed.
+template<typename T>
+class radix_tree_view {
+public:
+	typedef std::size_t size_type;
+
+	class const_iterator {
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef std::ptrdiff_t difference_type;
+		typedef const_iterator value_type;
+		typedef const const_iterator* pointer;
+		typedef const const_iterator& reference;
+
+		const_iterator() :m_view(NULL), m_index(0) { }
+
+		// the element itself: *it and it-> give the iterator back, read through key() and value()
+		reference operator*() const { return *this; }
+		pointer operator->() const { return this; }
+		const char* key() const { return m_view->key(m_index); }
+		int key_length() const { return m_view->key_length(m_index); }
+		const T& value() const { return m_view->value(m_index); }
+
+		const_iterator& operator++() { m_index++; return *this; }
+		const_iterator operator++(int) { const_iterator copy = *this; m_index++; return copy; }
+		const_iterator& operator--() { m_index--; return *this; }
+		const_iterator operator--(int) { const_iterator copy = *this; m_index--; return copy; }
+		bool operator==(const const_iterator& rhs) const { return m_index == rhs.m_index; }
+		bool operator!=(const const_iterator& rhs) const { return m_index != rhs.m_index; }
+	private:
+		friend class radix_tree_view;
+		const_iterator(const radix_tree_view* view, std::uint64_t index) :m_view(view), m_index(index) { }
+
+		const radix_tree_view* m_view;
+		std::uint64_t m_index;
+	};
+	typedef radix_tree_range<const_iterator> range;
+
+	radix_tree_view() { reset(); }
+	~radix_tree_view() { close(); }
+
+	// maps the image in the file path; false when it cannot be mapped or was not written for this T on this machine
+	bool open(const char* path);
+	// uses an image already in memory, which must stay alive and unchanged while the view uses it
+	bool attach(const void* image, std::size_t size);
+	void close();
+	bool is_open() const { return m_image != NULL; }
+
+	size_type size() const { return static_cast<size_type>(m_record_count); }
+	bool empty() const { return m_record_count == 0; }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, m_record_count); }
+
+	const_iterator find(const char* key, int len) const;
+	const_iterator longest_match(const char* key, int len) const;
+	// every key that starts with key[0, len), a contiguous run of records
+	range prefix_range(const char* key, int len) const;
+	void prefix_match(const char* key, int len, std::vector<const_iterator>& vec, size_type limit = size_type(-1)) const;
+#ifdef RADIX_TREE_STRING_VIEW
+	const_iterator find(std::string_view key) const { return find(key.data(), static_cast<int>(key.size())); }
+	const_iterator longest_match(std::string_view key) const { return longest_match(key.data(), static_cast<int>(key.size())); }
+	range prefix_range(std::string_view key) const { return prefix_range(key.data(), static_cast<int>(key.size())); }
+	void prefix_match(std::string_view key, std::vector<const_iterator>& vec, size_type limit = size_type(-1)) const { prefix_match(key.data(), static_cast<int>(key.size()), vec, limit); }
+#endif
+private:
+	radix_tree_view(const radix_tree_view&);
+	radix_tree_view& operator=(const radix_tree_view&);
+
+	void reset();
+	const char* key(std::uint64_t i) const { return m_keys + m_offsets[i]; }
+	int key_length(std::uint64_t i) const { return static_cast<int>(m_offsets[i + 1] - m_offsets[i]); }
+	const T& value(std::uint64_t i) const { return m_values[i]; }
+	bool has_value(const radix_tree_image_node& node) const { return key_length(node.first) == static_cast<int>(node.depth + node.label_len); }
+	// whether key[node.depth, node.depth + n) equals the first n bytes of the node's label
+	bool match_label(const radix_tree_image_node& node, const char* key, int n) const { return radix_equal(key + node.depth, this->key(node.first) + node.depth, n); }
+	// the child of node whose label starts with byte, NULL when there is none
+	const radix_tree_image_node* child(const radix_tree_image_node& node, unsigned char byte) const;
+
+	const char* m_image;
+	std::size_t m_size;
+	bool m_mapped;
+	std::uint64_t m_node_count;
+	std::uint64_t m_record_count;
+	const radix_tree_image_node* m_nodes;
+	const unsigned char* m_edges;
+	const std::uint64_t* m_offsets;
+	const T* m_values;
+	const char* m_keys;
+};
+
+template<typename T>
+void radix_tree_view<T>::reset()
+{
+	m_image = NULL;
+	m_size = 0;
+	m_mapped = false;
+	m_node_count = 0;
+	m_record_count = 0;
+	m_nodes = NULL;
+	m_edges = NULL;
+	m_offsets = NULL;
+	m_values = NULL;
+	m_keys = NULL;
+}
+
+template<typename T>
+bool radix_tree_view<T>::attach(const void* image, std::size_t size)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "values are read from the image bytewise");
+
+	radix_tree_image_header header;
+
+	close();
+	if (image == NULL || size < sizeof(header))
+		return false;
+	std::memcpy(&header, image, sizeof(header));
+
+	std::uint64_t value_align = std::alignment_of<T>::value > 8 ? std::alignment_of<T>::value : 8;
+	if (std::memcmp(header.magic, radix_tree_image_magic, sizeof(header.magic)) != 0 || header.byte_order != 0x01020304
+		|| header.version != radix_tree_image_version || header.value_size != sizeof(T) || header.value_align != value_align
+		|| header.node_count > radix_tree_image_max_count || header.record_count > radix_tree_image_max_count
+		|| header.size > size || header.keys > header.size
+		|| header.nodes + header.node_count * sizeof(radix_tree_image_node) > header.edges
+		|| header.edges + header.node_count > header.offsets
+		|| header.offsets + (header.record_count + 1) * sizeof(std::uint64_t) > header.values
+		|| header.values + header.record_count * sizeof(T) > header.keys
+		|| (reinterpret_cast<std::uintptr_t>(image) + header.values) % value_align != 0)
+		return false;
+
+	const char* base = static_cast<const char*>(image);
+	m_image = base;
+	m_size = size;
+	m_node_count = header.node_count;
+	m_record_count = header.record_count;
+	m_nodes = reinterpret_cast<const radix_tree_image_node*>(base + header.nodes);
+	m_edges = reinterpret_cast<const unsigned char*>(base + header.edges);
+	m_offsets = reinterpret_cast<const std::uint64_t*>(base + header.offsets);
+	m_values = reinterpret_cast<const T*>(base + header.values);
+	m_keys = base + header.keys;
+
+	return true;
+}
+
+template<typename T>
+bool radix_tree_view<T>::open(const char* path)
+{
+	close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	const void* image = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart != 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL) {
+		image = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		// the view keeps the file mapped, the handles can go
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (image == NULL)
+		return false;
+	if (!attach(image, static_cast<std::size_t>(size.QuadPart))) {
+		UnmapViewOfFile(image);
+		return false;
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void* image = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size != 0)
+		image = mmap(NULL, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (image == MAP_FAILED)
+		return false;
+	if (!attach(image, static_cast<std::size_t>(st.st_size))) {
+		munmap(image, static_cast<std::size_t>(st.st_size));
+		return false;
+	}
+#endif
+	m_mapped = true;
+
+	return true;
+}
+
+template<typename T>
+void radix_tree_view<T>::close()
+{
+	if (m_mapped) {
+#if defined(_WIN32)
+		UnmapViewOfFile(m_image);
+#else
+		munmap(const_cast<char*>(m_image), m_size);
+#endif
+	}
+	reset();
+}
+
+template<typename T>
+const radix_tree_image_node* radix_tree_view<T>::child(const radix_tree_image_node& node, unsigned char byte) const
+{
+	// children are sorted by first byte
+	std::uint32_t lo = node.first_child, hi = node.first_child + node.child_count;
+
+	while (lo < hi) {
+		std::uint32_t mid = lo + (hi - lo) / 2;
+		if (m_edges[mid] < byte)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < node.first_child + node.child_count && m_edges[lo] == byte ? &m_nodes[lo] : NULL;
+}
+
+template<typename T>
+typename radix_tree_view<T>::const_iterator radix_tree_view<T>::find(const char* key, int len) const
+{
+	const radix_tree_image_node* node = m_node_count != 0 ? &m_nodes[0] : NULL;
+
+	while (node != NULL) {
+		int end = static_cast<int>(node->depth + node->label_len);
+		if (len < end || !match_label(*node, key, node->label_len))
+			break;
+		if (len == end)
+			return has_value(*node) ? const_iterator(this, node->first) : this->end();
+		node = child(*node, static_cast<unsigned char>(key[end]));
+	}
+
+	return this->end();
+}
+
+template<typename T>
+typename radix_tree_view<T>::const_iterator radix_tree_view<T>::longest_match(const char* key, int len) const
+{
+	const radix_tree_image_node* node = m_node_count != 0 ? &m_nodes[0] : NULL;
+	std::uint64_t best = m_record_count;
+
+	while (node != NULL) {
+		int end = static_cast<int>(node->depth + node->label_len);
+		if (len < end || !match_label(*node, key, node->label_len))
+			break;
+		if (has_value(*node))
+			best = node->first;
+		if (len == end)
+			break;
+		node = child(*node, static_cast<unsigned char>(key[end]));
+	}
+
+	return const_iterator(this, best);
+}
+
+template<typename T>
+typename radix_tree_view<T>::range radix_tree_view<T>::prefix_range(const char* key, int len) const
+{
+	const radix_tree_image_node* node = m_node_count != 0 ? &m_nodes[0] : NULL;
+
+	while (node != NULL) {
+		int end = static_cast<int>(node->depth + node->label_len);
+		// the key ends inside this label: the whole subtree matches when the label starts with the rest of the key
+		if (len <= end) {
+			if (!match_label(*node, key, len - static_cast<int>(node->depth)))
+				break;
+			return range(const_iterator(this, node->first), const_iterator(this, node->last));
+		}
+		if (!match_label(*node, key, node->label_len))
+			break;
+		node = child(*node, static_cast<unsigned char>(key[end]));
+	}
+
+	return range(this->end(), this->end());
+}
+
+template<typename T>
+void radix_tree_view<T>::prefix_match(const char* key, int len, std::vector<const_iterator>& vec, size_type limit) const
+{
+	vec.clear();
+
+	range r = prefix_range(key, len);
+	for (const_iterator it = r.begin(); it != r.end() && vec.size() < limit; ++it)
+		vec.push_back(it);
+}
@@ -1,101 +1,122 @@
 #pragma once
+#include<cstddef>
 #include<iterator>
 #include<functional>
+#include<type_traits>
+
+// nodes holding a value are threaded in key order into a circular doubly linked
+// list; the tree owns the link that closes the circle and serves as end()
+struct radix_tree_link {
+	radix_tree_link() :m_prev(this), m_next(this) { }
+	radix_tree_link* m_prev;
+	radix_tree_link* m_next;
+};
 
 template<typename K, typename T, class Compare = std::less<K>> class radix_tree;
 template<typename K, typename T, class Compare = std::less<K>> class radix_tree_node;
-template<typename K, typename T, class Compare = std::less<K>>
-class radix_tree_it :public std::iterator<std::forward_iterator_tag, std::pair<K, T>> {
+// Walks the key-ordered list threading the nodes that hold a value, so ++ and --
+// are a single pointer step. The tree's own link is the past-the-end position.
+template<typename K, typename T, class Compare = std::less<K>, bool Const = false>
+class radix_tree_it {
 	friend class radix_tree<K, T, Compare>;
+	template<typename, typename, class, bool> friend class radix_tree_it;
 public:
+	typedef std::bidirectional_iterator_tag iterator_category;
+	typedef std::pair<const K, T> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+	typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
 	radix_tree_it():m_pointee(0){}
 	radix_tree_it(const radix_tree_it& r) :m_pointee(r.m_pointee) {}
+	// iterator converts to const_iterator, not the other way round
+	template<bool C, typename = typename std::enable_if<Const && !C>::type>
+	radix_tree_it(const radix_tree_it<K, T, Compare, C>& r) :m_pointee(r.m_pointee) {}
 	radix_tree_it& operator=(const radix_tree_it r) {
 		m_pointee = r.m_pointee;
 		return *this;
 	}
 	~radix_tree_it(){}
-	std::pair<const K, T>& operator*  () const;
-	std::pair<const K, T>* operator-> () const;
-	const radix_tree_it<K, T, Compare>& operator++();
-	radix_tree_it<K, T, Compare> operator++(int);
-	bool operator!=(const radix_tree_it<K, T, Compare>& lhs) const;
-	bool operator==(const radix_tree_it<K, T, Compare>& lhs) const;
+	reference operator*  () const;
+	pointer operator-> () const;
+	radix_tree_it& operator++();
+	radix_tree_it operator++(int);
+	radix_tree_it& operator--();
+	radix_tree_it operator--(int);
+	bool operator!=(const radix_tree_it& lhs) const;
+	bool operator==(const radix_tree_it& lhs) const;
 private:
-	radix_tree_node<K, T, Compare>* m_pointee;
-	radix_tree_it(radix_tree_node<K, T, Compare>* p) :m_pointee(p){}
-	radix_tree_node<K, T, Compare>* increment(radix_tree_node<K, T, Compare>* node) const;
-	radix_tree_node<K, T, Compare>* descend(radix_tree_node<K, T, Compare>* node) const;
+	radix_tree_link* m_pointee;
+	radix_tree_it(radix_tree_link* p) :m_pointee(p){}
+	radix_tree_node<K, T, Compare>* node() const { return static_cast<radix_tree_node<K, T, Compare>*>(m_pointee); }
 };
 
-
-template<typename K, typename T, class Compare>
-radix_tree_node<K, T, Compare>* radix_tree_it<K, T, Compare>::increment(radix_tree_node<K, T, Compare>* node) const
+template <typename K, typename T, typename Compare, bool Const>
+typename radix_tree_it<K, T, Compare, Const>::reference radix_tree_it<K, T, Compare, Const>::operator* () const
 {
-	radix_tree_node<K, T, Compare>* parent = node->m_parent;
-
-	if (parent == NULL)
-		return NULL;
-
-	typename radix_tree_node<K, T, Compare>::it_child it = parent->m_children.find(node->m_key);
-	assert(it != parent->m_children.end());
-	++it;
-
-	if (it == parent->m_children.end())
-		return increment(parent);
-	else
-		return descend(it->second);
+	return node()->m_value;
 }
 
-template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>* radix_tree_it<K, T, Compare>::descend(radix_tree_node<K, T, Compare>* node) const
+template <typename K, typename T, typename Compare, bool Const>
+typename radix_tree_it<K, T, Compare, Const>::pointer radix_tree_it<K, T, Compare, Const>::operator-> () const
 {
-	if (node->m_is_leaf)
-		return node;
-
-	typename radix_tree_node<K, T, Compare>::it_child it = node->m_children.begin();
-
-	assert(it != node->m_children.end());
-
-	return descend(it->second);
+	return &node()->m_value;
 }
 
-template <typename K, typename T, typename Compare>
-std::pair<const K, T>& radix_tree_it<K, T, Compare>::operator* () const
+template <typename K, typename T, typename Compare, bool Const>
+bool radix_tree_it<K, T, Compare, Const>::operator!= (const radix_tree_it& lhs) const
 {
-	return *m_pointee->m_value;
+	return m_pointee != lhs.m_pointee;
 }
 
-template <typename K, typename T, typename Compare>
-std::pair<const K, T>* radix_tree_it<K, T, Compare>::operator-> () const
+template <typename K, typename T, typename Compare, bool Const>
+bool radix_tree_it<K, T, Compare, Const>::operator== (const radix_tree_it& lhs) const
 {
-	return m_pointee->m_value;
+	return m_pointee == lhs.m_pointee;
 }
 
-template <typename K, typename T, typename Compare>
-bool radix_tree_it<K, T, Compare>::operator!= (const radix_tree_it<K, T, Compare>& lhs) const
+template <typename K, typename T, typename Compare, bool Const>
+radix_tree_it<K, T, Compare, Const>& radix_tree_it<K, T, Compare, Const>::operator++ ()
 {
-	return m_pointee != lhs.m_pointee;
+	if (m_pointee != NULL) // a default constructed iterator stays singular
+		m_pointee = m_pointee->m_next;
+	return *this;
 }
 
-template <typename K, typename T, typename Compare>
-bool radix_tree_it<K, T, Compare>::operator== (const radix_tree_it<K, T, Compare>& lhs) const
+template <typename K, typename T, typename Compare, bool Const>
+radix_tree_it<K, T, Compare, Const> radix_tree_it<K, T, Compare, Const>::operator++ (int)
 {
-	return m_pointee == lhs.m_pointee;
+	radix_tree_it copy(*this);
+	++(*this);
+	return copy;
 }
 
-template <typename K, typename T, typename Compare>
-const radix_tree_it<K, T, Compare>& radix_tree_it<K, T, Compare>::operator++ ()
+template <typename K, typename T, typename Compare, bool Const>
+radix_tree_it<K, T, Compare, Const>& radix_tree_it<K, T, Compare, Const>::operator-- ()
 {
-	if (m_pointee != NULL) // it is undefined behaviour to dereference iterator that is out of bounds...
-		m_pointee = increment(m_pointee);
+	if (m_pointee != NULL)
+		m_pointee = m_pointee->m_prev;
 	return *this;
 }
 
-template <typename K, typename T, typename Compare>
-radix_tree_it<K, T, Compare> radix_tree_it<K, T, Compare>::operator++ (int)
+template <typename K, typename T, typename Compare, bool Const>
+radix_tree_it<K, T, Compare, Const> radix_tree_it<K, T, Compare, Const>::operator-- (int)
 {
-	radix_tree_it<K, T, Compare> copy(*this);
-	++(*this);
+	radix_tree_it copy(*this);
+	--(*this);
 	return copy;
 }
+
+// [first, last) over the key-ordered list, usable in a range-based for; the keys
+// sharing a prefix are contiguous in the list, so a prefix range is two iterators
+template<typename It>
+class radix_tree_range {
+public:
+	radix_tree_range(It first, It last) :m_first(first), m_last(last) {}
+	It begin() const { return m_first; }
+	It end() const { return m_last; }
+	bool empty() const { return m_first == m_last; }
+private:
+	It m_first;
+	It m_last;
+};
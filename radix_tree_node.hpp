@@ -1,47 +1,113 @@
 #pragma once
-#include<map>
+#include<cstddef>
+#include<cstring>
 #include<functional>
+#include<new>
+#include<utility>
+
+#include "radix_tree_children.hpp"
 
 template<typename K,typename T,typename Compare>
-class radix_tree_node {
+class radix_tree_node : public radix_tree_link {
 	friend class radix_tree<K, T, Compare>;
-	friend class radix_tree_it<K, T, Compare>;
+	template<typename, typename, class, bool> friend class radix_tree_it;
 	typedef std::pair<const K, T> value_type;
-	typedef typename std::map<K, radix_tree_node<K, T, Compare>*, Compare>::iterator it_child;
 private:
-	radix_tree_node(Compare& pred) :m_children(std::map<K, radix_tree_node<K, T, Compare>*, Compare>(pred)), m_parent(NULL), m_value(NULL), m_depth(0), m_is_leaf(false), m_key(), m_pred(pred) { }
-	radix_tree_node(const value_type& val, Compare& pred);
+	//ȵıǩֱӴڽڵıǩڴУm_labelһָСֽڴĵַ
+	enum { inline_label = 15 };
+
+	radix_tree_node() :m_children(), m_parent(NULL), m_depth(0), m_key_len(0), m_has_value(false) { }
 	radix_tree_node(const radix_tree_node&);
 	radix_tree_node& operator=(const radix_tree_node&);
 	~radix_tree_node();
-	std::map<K, radix_tree_node<K, T, Compare>*, Compare> m_children;
+	//ߵıǩĵһֽڣĸڵ㰴ֽڵ
+	unsigned char edge() const { return static_cast<unsigned char>(label()[0]); }
+	//ߵıǩm_key_lenֽ
+	const char* label() const { return m_key_len <= inline_label ? m_label : pooled(); }
+	//ǩΪaʼlen_aֽڽbʼlen_bֽڣabָǰıǩ
+	//ǰıǩȡڴأ֮黹pool
+	void set_label(radix_tree_pool& pool, const char* a, int len_a, const char* b = NULL, int len_b = 0);
+	//ڴеıǩ黹pool
+	void free_label(radix_tree_pool& pool);
+	char* pooled() const {
+		char* p;
+		memcpy(&p, m_label + inline_label - sizeof(char*), sizeof(char*));
+		return p;
+	}
+	//args͵عŵֵ
+	template<class... Args> void set_value(Args&&... args);
+	void clear_value();
+	//ߵıǩͽڵ㱾radix_tree_poolУͷţֻŵֵ
+	radix_tree_children<radix_tree_node<K, T, Compare> > m_children;
 	radix_tree_node<K, T, Compare>* m_parent;
-	value_type* m_value;
+	//ڵļֵ͵شţֻm_has_valueΪtrueʱm_valueǻ
+	union {
+		value_type m_value;
+	};
 	int m_depth;
-	bool m_is_leaf;
-	K m_key;
-	Compare& m_pred;
+	int m_key_len;
+	bool m_has_value;
+	char m_label[inline_label];
+#ifdef RADIX_TREE_SUBTREE_COUNTS
+	//ڵдŵֵĸԼ
+	std::size_t m_count = 0;
+#endif
 };
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>::radix_tree_node(const value_type& val, Compare& pred) :
-	m_children(std::map<K, radix_tree_node<K, T, Compare>*, Compare>(pred)),
-	m_parent(NULL),
-	m_value(NULL),
-	m_depth(0),
-	m_is_leaf(false),
-	m_key(),
-	m_pred(pred)
+radix_tree_node<K, T, Compare>::~radix_tree_node()
 {
-	m_value = new value_type(val);
+	clear_value();
 }
 
 template <typename K, typename T, typename Compare>
-radix_tree_node<K, T, Compare>::~radix_tree_node()
+void radix_tree_node<K, T, Compare>::set_label(radix_tree_pool& pool, const char* a, int len_a, const char* b, int len_b)
+{
+	int len = len_a + len_b;
+
+	if (len <= inline_label) {
+		//abܺm_labelصȸƳ
+		char bytes[inline_label];
+		memcpy(bytes, a, len_a);
+		if (len_b != 0)
+			memcpy(bytes + len_a, b, len_b);
+		free_label(pool);
+		memcpy(m_label, bytes, len);
+	}
+	else {
+		char* p = static_cast<char*>(pool.allocate(len));
+		memcpy(p, a, len_a);
+		if (len_b != 0)
+			memcpy(p + len_a, b, len_b);
+		free_label(pool);
+		memcpy(m_label + inline_label - sizeof(char*), &p, sizeof(char*));
+	}
+	m_key_len = len;
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree_node<K, T, Compare>::free_label(radix_tree_pool& pool)
+{
+	if (m_key_len > inline_label)
+		pool.deallocate(pooled(), m_key_len);
+	m_key_len = 0;
+}
+
+template <typename K, typename T, typename Compare>
+template<class... Args>
+void radix_tree_node<K, T, Compare>::set_value(Args&&... args)
 {
-	it_child it;
-	for (it = m_children.begin(); it != m_children.end(); ++it) {
-		delete it->second;
+	assert(!m_has_value);
+
+	new (&m_value) value_type(std::forward<Args>(args)...);
+	m_has_value = true;
+}
+
+template <typename K, typename T, typename Compare>
+void radix_tree_node<K, T, Compare>::clear_value()
+{
+	if (m_has_value) {
+		m_value.~value_type();
+		m_has_value = false;
 	}
-	delete m_value;
-}
\ No newline at end of file
+}
@@ -0,0 +1,440 @@
+#pragma once
+#include<atomic>
+#include<cstddef>
+#include<cstring>
+#include<new>
+#include<utility>
+#include<vector>
+
+#include "radix_tree.hpp"
+
+// A radix tree whose versions share structure. Nodes never change once built:
+// insert and erase copy the nodes on the path from the root to the key, point the
+// copies at the untouched subtrees of the old version, and leave the old version
+// as it was. snapshot() hands out the current root with one more reference, so it
+// is O(1), and a version stays readable for as long as it is held no matter what
+// the writer does next. Nodes and values carry atomic reference counts; the last
+// version to let go of a node frees it, so readers holding old versions on other
+// threads never block the writer and never see memory go away under them.
+//
+// One thread at a time may call insert/erase on a persistent_radix_tree; any
+// number of threads may read their own versions meanwhile. A version is handed
+// to another thread by copying it under whatever synchronisation carries it there.
+template<typename K, typename T>
+class persistent_radix_tree {
+	struct node;
+public:
+	typedef K key_type;
+	typedef T mapped_type;
+	typedef std::pair<const K, T> value_type;
+	typedef std::size_t size_type;
+
+	// an immutable version of the tree
+	class version {
+		friend class persistent_radix_tree;
+	public:
+		version() :m_root(NULL), m_size(0) { }
+		version(const version& other) :m_root(acquire(other.m_root)), m_size(other.m_size) { }
+		version& operator=(const version& other);
+		~version() { release(m_root); }
+
+		size_type size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		// pointers stay valid as long as this version is held
+		const value_type* find(const K& key) const { return find(radix_data(key), radix_length(key)); }
+		const value_type* longest_match(const K& key) const { return longest_match(radix_data(key), radix_length(key)); }
+		void prefix_match(const K& key, std::vector<const value_type*>& vec) const { prefix_match(radix_data(key), radix_length(key), vec); }
+		const value_type* find(const char* key, int len) const;
+		const value_type* longest_match(const char* key, int len) const;
+		void prefix_match(const char* key, int len, std::vector<const value_type*>& vec) const;
+		// calls visit on every element in key order until it returns false
+		template<class Visitor> void for_each(Visitor visit) const;
+	private:
+		version(node* root, size_type size) :m_root(root), m_size(size) { }
+
+		node* m_root;
+		size_type m_size;
+	};
+
+	persistent_radix_tree() :m_current(make_node(NULL, 0, NULL, 0, NULL, NULL, 0), 0) { }
+	// copies share every node, the trees go their own way with the next update
+	persistent_radix_tree(const persistent_radix_tree& other) :m_current(other.m_current) { }
+	persistent_radix_tree& operator=(const persistent_radix_tree& other) { m_current = other.m_current; return *this; }
+
+	size_type size() const { return m_current.size(); }
+	bool empty() const { return m_current.empty(); }
+	version snapshot() const { return m_current; }
+
+	const value_type* find(const K& key) const { return m_current.find(key); }
+	const value_type* longest_match(const K& key) const { return m_current.longest_match(key); }
+	void prefix_match(const K& key, std::vector<const value_type*>& vec) const { m_current.prefix_match(key, vec); }
+	template<class Visitor> void for_each(Visitor visit) const { m_current.for_each(visit); }
+
+	bool insert(const value_type& val);
+	bool erase(const K& key) { return erase(radix_data(key), radix_length(key)); }
+	bool erase(const char* key, int len);
+	void clear() { m_current = persistent_radix_tree().m_current; }
+private:
+	// shared by every copy of the node that holds it
+	struct holder {
+		std::atomic<std::size_t> m_refs;
+		value_type m_value;
+		holder(const value_type& val) :m_refs(1), m_value(val) { }
+	};
+	// children and label are stored behind the node: children[size], their edge bytes[size], label[key_len]
+	struct node {
+		std::atomic<std::size_t> m_refs;
+		holder* m_value;
+		int m_key_len;
+		int m_size;
+		node** children() { return reinterpret_cast<node**>(this + 1); }
+		unsigned char* keys() { return reinterpret_cast<unsigned char*>(children() + m_size); }
+		char* key() { return reinterpret_cast<char*>(keys() + m_size); }
+		unsigned char edge() { return static_cast<unsigned char>(key()[0]); }
+	};
+
+	static node* acquire(node* n);
+	static void release(node* n);
+	static void release(holder* h);
+	// a node with the label key1 + key2; takes a reference on value and on every child
+	static node* make_node(const char* key1, int len1, const char* key2, int len2, holder* value, node** children, int size);
+	static node* find_child(node* n, unsigned char c);
+	// copy of n with child put in, replacing the child with the same edge byte; child NULL removes the child indexed by c
+	static node* replace_child(node* n, unsigned char c, node* child);
+	// the node left in place of n when it holds no value and a single child: n and the child as one node
+	static node* collapse(node* n);
+
+
+	version m_current;
+};
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::version& persistent_radix_tree<K, T>::version::operator=(const version& other)
+{
+	node* root = acquire(other.m_root);
+
+	release(m_root);
+	m_root = root;
+	m_size = other.m_size;
+
+	return *this;
+}
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::node* persistent_radix_tree<K, T>::acquire(node* n)
+{
+	if (n != NULL)
+		n->m_refs.fetch_add(1, std::memory_order_relaxed);
+
+	return n;
+}
+
+template<typename K, typename T>
+void persistent_radix_tree<K, T>::release(node* n)
+{
+	// children are released through an explicit stack, a long chain of last references must not recurse
+	std::vector<node*> stack;
+
+	for (;;) {
+		if (n != NULL && n->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			for (int i = 0; i < n->m_size; i++)
+				stack.push_back(n->children()[i]);
+			release(n->m_value);
+			::operator delete(n);
+		}
+		if (stack.empty())
+			break;
+		n = stack.back();
+		stack.pop_back();
+	}
+}
+
+template<typename K, typename T>
+void persistent_radix_tree<K, T>::release(holder* h)
+{
+	if (h != NULL && h->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		delete h;
+}
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::node* persistent_radix_tree<K, T>::make_node(const char* key1, int len1, const char* key2, int len2, holder* value, node** children, int size)
+{
+	node* n = static_cast<node*>(::operator new(sizeof(node) + size * (sizeof(node*) + 1) + len1 + len2));
+
+	new (&n->m_refs) std::atomic<std::size_t>(1);
+	n->m_value = value;
+	if (value != NULL)
+		value->m_refs.fetch_add(1, std::memory_order_relaxed);
+	n->m_key_len = len1 + len2;
+	n->m_size = size;
+	for (int i = 0; i < size; i++) {
+		n->children()[i] = acquire(children[i]);
+		n->keys()[i] = children[i]->edge();
+	}
+	if (len1 != 0)
+		memcpy(n->key(), key1, len1);
+	if (len2 != 0)
+		memcpy(n->key() + len1, key2, len2);
+
+	return n;
+}
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::node* persistent_radix_tree<K, T>::find_child(node* n, unsigned char c)
+{
+	for (int i = 0; i < n->m_size; i++) {
+		if (n->keys()[i] == c)
+			return n->children()[i];
+		if (n->keys()[i] > c)
+			break;
+	}
+
+	return NULL;
+}
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::node* persistent_radix_tree<K, T>::replace_child(node* n, unsigned char c, node* child)
+{
+	std::vector<node*> children;
+	bool placed = child == NULL;
+
+	children.reserve(n->m_size + 1);
+	for (int i = 0; i < n->m_size; i++) {
+		if (!placed && n->keys()[i] > c) {
+			children.push_back(child);
+			placed = true;
+		}
+		if (n->keys()[i] != c)
+			children.push_back(n->children()[i]);
+		else if (!placed) {
+			children.push_back(child);
+			placed = true;
+		}
+	}
+	if (!placed)
+		children.push_back(child);
+
+	return make_node(n->key(), n->m_key_len, NULL, 0, n->m_value, children.empty() ? NULL : &children[0], static_cast<int>(children.size()));
+}
+
+template<typename K, typename T>
+typename persistent_radix_tree<K, T>::node* persistent_radix_tree<K, T>::collapse(node* n)
+{
+	node* child = n->children()[0];
+
+	return make_node(n->key(), n->m_key_len, child->key(), child->m_key_len, child->m_value, child->children(), child->m_size);
+}
+
+template<typename K, typename T>
+bool persistent_radix_tree<K, T>::insert(const value_type& val)
+{
+	const char* key = radix_data(val.first);
+	int len = radix_length(val.first);
+	// the nodes above the change, copied bottom-up after a loop descent so a deep chain of nodes does not recurse
+	std::vector<node*> path;
+	node* n = m_current.m_root;
+	int depth = 0;
+	node* sub;
+
+	for (;;) {
+		if (depth == len) {
+			if (n->m_value != NULL)
+				return false;
+
+			// sub takes the place of n itself
+			holder* h = new holder(val);
+			sub = make_node(n->key(), n->m_key_len, NULL, 0, h, n->children(), n->m_size);
+			release(h);
+			break;
+		}
+
+		unsigned char c = static_cast<unsigned char>(key[depth]);
+		node* child = find_child(n, c);
+
+		path.push_back(n);
+		if (child == NULL) {
+			holder* h = new holder(val);
+			sub = make_node(key + depth, len - depth, NULL, 0, h, NULL, 0);
+			release(h);
+			break;
+		}
+
+		int rest = len - depth;
+		int count = radix_mismatch(key + depth, child->key(), child->m_key_len < rest ? child->m_key_len : rest);
+
+		if (count == child->m_key_len) {
+			n = child;
+			depth += count;
+			continue;
+		}
+
+		// the key leaves the child's label after count bytes: split the label there
+		node* children[2];
+		int size = 0;
+		holder* h = new holder(val);
+		node* lower = make_node(child->key() + count, child->m_key_len - count, NULL, 0, child->m_value, child->children(), child->m_size);
+		node* leaf = count != rest ? make_node(key + depth + count, rest - count, NULL, 0, h, NULL, 0) : NULL;
+
+		if (leaf != NULL && leaf->edge() < lower->edge())
+			children[size++] = leaf;
+		children[size++] = lower;
+		if (leaf != NULL && leaf->edge() > lower->edge())
+			children[size++] = leaf;
+
+		sub = make_node(key + depth, count, NULL, 0, leaf == NULL ? h : NULL, children, size);
+		release(lower);
+		release(leaf);
+		release(h);
+		break;
+	}
+
+	// sub starts with the edge byte of the child it replaces
+	for (std::size_t i = path.size(); i-- != 0; ) {
+		node* copy = replace_child(path[i], sub->edge(), sub);
+		release(sub);
+		sub = copy;
+	}
+
+	m_current = version(sub, m_current.m_size + 1);
+
+	return true;
+}
+
+template<typename K, typename T>
+bool persistent_radix_tree<K, T>::erase(const char* key, int len)
+{
+	// the nodes from the root down to the key, copied bottom-up as in insert
+	std::vector<node*> path;
+	node* n = m_current.m_root;
+	int depth = 0;
+
+	path.push_back(n);
+	while (depth != len) {
+		node* child = find_child(n, static_cast<unsigned char>(key[depth]));
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			return false;
+		n = child;
+		depth += child->m_key_len;
+		path.push_back(n);
+	}
+	if (n->m_value == NULL)
+		return false;
+
+	// the new version of n, NULL when n goes away
+	node* sub;
+	if (path.size() != 1 && n->m_size == 0)
+		sub = NULL;
+	else if (path.size() != 1 && n->m_size == 1)
+		sub = collapse(n);
+	else
+		sub = make_node(n->key(), n->m_key_len, NULL, 0, NULL, n->children(), n->m_size);
+
+	for (std::size_t i = path.size() - 1; i != 0; i--) {
+		node* copy = replace_child(path[i - 1], path[i]->edge(), sub);
+		release(sub);
+
+		// a node without a value keeps at least two children, except for the root
+		if (i - 1 != 0 && copy->m_value == NULL && copy->m_size == 1) {
+			node* merged = collapse(copy);
+			release(copy);
+			copy = merged;
+		}
+		sub = copy;
+	}
+
+	m_current = version(sub, m_current.m_size - 1);
+
+	return true;
+}
+
+template<typename K, typename T>
+const typename persistent_radix_tree<K, T>::value_type* persistent_radix_tree<K, T>::version::find(const char* key, int len) const
+{
+	node* n = m_root;
+	int depth = 0;
+
+	if (n == NULL)
+		return NULL;
+
+	while (depth != len) {
+		node* child = find_child(n, static_cast<unsigned char>(key[depth]));
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			return NULL;
+		n = child;
+		depth += child->m_key_len;
+	}
+
+	return n->m_value != NULL ? &n->m_value->m_value : NULL;
+}
+
+template<typename K, typename T>
+const typename persistent_radix_tree<K, T>::value_type* persistent_radix_tree<K, T>::version::longest_match(const char* key, int len) const
+{
+	node* n = m_root;
+	int depth = 0;
+	const value_type* best = NULL;
+
+	while (n != NULL) {
+		if (n->m_value != NULL)
+			best = &n->m_value->m_value;
+		if (depth == len)
+			break;
+
+		node* child = find_child(n, static_cast<unsigned char>(key[depth]));
+		if (child == NULL || child->m_key_len > len - depth || !radix_equal(key + depth, child->key(), child->m_key_len))
+			break;
+		n = child;
+		depth += child->m_key_len;
+	}
+
+	return best;
+}
+
+template<typename K, typename T>
+void persistent_radix_tree<K, T>::version::prefix_match(const char* key, int len, std::vector<const value_type*>& vec) const
+{
+	node* n = m_root;
+	int depth = 0;
+
+	vec.clear();
+	if (n == NULL)
+		return;
+
+	while (depth != len) {
+		node* child = find_child(n, static_cast<unsigned char>(key[depth]));
+		int rest = len - depth;
+		if (child == NULL || !radix_equal(key + depth, child->key(), child->m_key_len < rest ? child->m_key_len : rest))
+			return;
+		n = child;
+		depth += child->m_key_len < rest ? child->m_key_len : rest;
+	}
+
+	std::vector<node*> stack(1, n);
+	while (!stack.empty()) {
+		n = stack.back();
+		stack.pop_back();
+		if (n->m_value != NULL)
+			vec.push_back(&n->m_value->m_value);
+		for (int i = n->m_size; i-- > 0; )
+			stack.push_back(n->children()[i]);
+	}
+}
+
+template<typename K, typename T>
+template<class Visitor>
+void persistent_radix_tree<K, T>::version::for_each(Visitor visit) const
+{
+	if (m_root == NULL)
+		return;
+
+	std::vector<node*> stack(1, m_root);
+	while (!stack.empty()) {
+		node* n = stack.back();
+		stack.pop_back();
+		if (n->m_value != NULL && !visit(static_cast<const value_type&>(n->m_value->m_value)))
+			return;
+		for (int i = n->m_size; i-- > 0; )
+			stack.push_back(n->children()[i]);
+	}
+}
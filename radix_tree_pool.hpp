@@ -0,0 +1,217 @@
+#pragma once
+#include<cassert>
+#include<cstddef>
+#include<new>
+
+#include "radix_tree_stats.hpp"
+
+// Slab allocator behind the nodes, child blocks and edge labels of a radix_tree.
+// Requests are rounded up to 16 bytes and carved out of large chunks; a freed
+// block goes on the free list of its size and is handed out again by the next
+// request of that size. release() returns every chunk at once, which is how
+// clear() and ~radix_tree() drop a whole tree without freeing it node by node.
+// Chunks start small and double up to chunk_size, so a tree with a handful of
+// keys stays small while a large one ends up in chunks big enough to be mapped
+// and unmapped directly by the C library instead of fragmenting its heap.
+// With a chunk size of 0 the pool forwards every request to operator new, so
+// sanitizer and debug builds still see each node as its own heap block.
+class radix_tree_pool {
+public:
+	explicit radix_tree_pool(std::size_t chunk_size = 1024 * 1024);
+	~radix_tree_pool() { release(); }
+
+	void* allocate(std::size_t n);
+	void deallocate(void* p, std::size_t n);
+	void release();
+	// takes over every chunk, oversized block and free block of other, which is left empty;
+	// lets threads build parts of a tree in private pools and hand them to the tree's pool
+	void merge(radix_tree_pool& other);
+	// true when release() frees everything handed out, false in pass-through mode
+	bool slabs() const { return m_chunk_size != 0; }
+	std::size_t bytes_reserved() const { return m_reserved; }
+	std::size_t chunk_size() const { return m_chunk_size; }
+	// requests served since the pool was made, counted only with RADIX_TREE_COUNTERS
+	std::size_t allocations() const { return m_allocations; }
+	// bytes a request of n bytes takes from the pool
+	std::size_t block_size(std::size_t n) const { return m_chunk_size == 0 || n > max_small ? n : round_up(n == 0 ? 1 : n); }
+private:
+	enum { granularity = 16, max_small = 2048, classes = max_small / granularity, first_chunk = 16 * 1024 };
+	union header {
+		struct { header* prev; header* next; } link;
+		std::max_align_t align;
+		char pad[granularity];
+	};
+
+	radix_tree_pool(const radix_tree_pool&);
+	radix_tree_pool& operator=(const radix_tree_pool&);
+
+	static std::size_t round_up(std::size_t n) { return (n + granularity - 1) / granularity * granularity; }
+
+	std::size_t m_chunk_size;
+	std::size_t m_next_chunk;
+	std::size_t m_reserved;
+	std::size_t m_allocations;
+	header* m_chunks;
+	header* m_large;
+	char* m_cur;
+	char* m_end;
+	void* m_free[classes];
+};
+
+inline radix_tree_pool::radix_tree_pool(std::size_t chunk_size) :
+	m_chunk_size(chunk_size == 0 ? 0 : round_up(chunk_size < static_cast<std::size_t>(4 * max_small) ? static_cast<std::size_t>(4 * max_small) : chunk_size)),
+	m_next_chunk(m_chunk_size < static_cast<std::size_t>(first_chunk) ? m_chunk_size : static_cast<std::size_t>(first_chunk)),
+	m_reserved(0),
+	m_allocations(0),
+	m_chunks(NULL),
+	m_large(NULL),
+	m_cur(NULL),
+	m_end(NULL)
+{
+	for (int i = 0; i < classes; i++)
+		m_free[i] = NULL;
+}
+
+inline void* radix_tree_pool::allocate(std::size_t n)
+{
+	RADIX_TREE_COUNT(m_allocations);
+
+	if (m_chunk_size == 0) {
+		m_reserved += n;
+		return ::operator new(n);
+	}
+
+	n = round_up(n == 0 ? 1 : n);
+
+	if (n > max_small) {
+		// oversized blocks (long edge labels) get their own allocation, linked so release() can find them
+		header* h = static_cast<header*>(::operator new(sizeof(header) + n));
+		h->link.prev = NULL;
+		h->link.next = m_large;
+		if (m_large != NULL)
+			m_large->link.prev = h;
+		m_large = h;
+		m_reserved += sizeof(header) + n;
+		return h + 1;
+	}
+
+	void*& head = m_free[n / granularity - 1];
+	if (head != NULL) {
+		void* p = head;
+		head = *static_cast<void**>(p);
+		return p;
+	}
+
+	if (m_cur == NULL || static_cast<std::size_t>(m_end - m_cur) < n) {
+		header* chunk = static_cast<header*>(::operator new(m_next_chunk));
+		chunk->link.next = m_chunks;
+		m_chunks = chunk;
+		m_cur = reinterpret_cast<char*>(chunk + 1);
+		m_end = reinterpret_cast<char*>(chunk) + m_next_chunk;
+		m_reserved += m_next_chunk;
+		if (m_next_chunk < m_chunk_size)
+			m_next_chunk = m_next_chunk * 2 < m_chunk_size ? m_next_chunk * 2 : m_chunk_size;
+	}
+
+	void* p = m_cur;
+	m_cur += n;
+	return p;
+}
+
+inline void radix_tree_pool::deallocate(void* p, std::size_t n)
+{
+	if (p == NULL)
+		return;
+
+	if (m_chunk_size == 0) {
+		m_reserved -= n;
+		::operator delete(p);
+		return;
+	}
+
+	n = round_up(n == 0 ? 1 : n);
+
+	if (n > max_small) {
+		header* h = static_cast<header*>(p) - 1;
+		if (h->link.prev != NULL)
+			h->link.prev->link.next = h->link.next;
+		else
+			m_large = h->link.next;
+		if (h->link.next != NULL)
+			h->link.next->link.prev = h->link.prev;
+		m_reserved -= sizeof(header) + n;
+		::operator delete(h);
+		return;
+	}
+
+	void*& head = m_free[n / granularity - 1];
+	*static_cast<void**>(p) = head;
+	head = p;
+}
+
+inline void radix_tree_pool::release()
+{
+	if (m_chunk_size == 0)
+		return;
+
+	while (m_chunks != NULL) {
+		header* next = m_chunks->link.next;
+		::operator delete(m_chunks);
+		m_chunks = next;
+	}
+	while (m_large != NULL) {
+		header* next = m_large->link.next;
+		::operator delete(m_large);
+		m_large = next;
+	}
+	for (int i = 0; i < classes; i++)
+		m_free[i] = NULL;
+
+	m_cur = NULL;
+	m_end = NULL;
+	m_next_chunk = m_chunk_size < static_cast<std::size_t>(first_chunk) ? m_chunk_size : static_cast<std::size_t>(first_chunk);
+	m_reserved = 0;
+}
+
+inline void radix_tree_pool::merge(radix_tree_pool& other)
+{
+	assert(slabs() == other.slabs());
+
+	if (&other == this)
+		return;
+
+	if (other.m_chunks != NULL) {
+		// the rest of other's current chunk is not reused, the chunk itself is freed by release()
+		header* tail = other.m_chunks;
+		while (tail->link.next != NULL)
+			tail = tail->link.next;
+		tail->link.next = m_chunks;
+		m_chunks = other.m_chunks;
+	}
+	if (other.m_large != NULL) {
+		header* tail = other.m_large;
+		while (tail->link.next != NULL)
+			tail = tail->link.next;
+		tail->link.next = m_large;
+		if (m_large != NULL)
+			m_large->link.prev = tail;
+		m_large = other.m_large;
+	}
+	for (int i = 0; i < classes; i++) {
+		void* p = other.m_free[i];
+		while (p != NULL) {
+			void* next = *static_cast<void**>(p);
+			*static_cast<void**>(p) = m_free[i];
+			m_free[i] = p;
+			p = next;
+		}
+		other.m_free[i] = NULL;
+	}
+	m_reserved += other.m_reserved;
+
+	other.m_chunks = NULL;
+	other.m_large = NULL;
+	other.m_cur = NULL;
+	other.m_end = NULL;
+	other.m_reserved = 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include<condition_variable>
+#include<cstddef>
+#include<deque>
+#include<mutex>
+#include<thread>
+
+// Background thread that runs teardown work handed over by radix_tree, so that
+// clearing or destroying a large tree does not stall the thread doing it. A tree
+// given a reclaimer with set_reclaimer() detaches its root, its value list and
+// the pool they live in, hands them over in one call and goes on with a fresh
+// pool; the stored values are destroyed and the memory freed here. Jobs run in
+// the order they were handed over, one at a time. One reclaimer can serve any
+// number of trees and must outlive them; its destructor finishes every job
+// handed over before it stops the thread.
+class radix_tree_reclaimer {
+public:
+	radix_tree_reclaimer();
+	~radix_tree_reclaimer();
+
+	// runs work(p) on the background thread
+	void defer(void* p, void (*work)(void*));
+	// blocks until every job handed over so far has run
+	void drain();
+	// jobs handed over and not finished yet
+	std::size_t pending() const;
+private:
+	struct job {
+		void* p;
+		void (*work)(void*);
+	};
+
+	radix_tree_reclaimer(const radix_tree_reclaimer&);
+	radix_tree_reclaimer& operator=(const radix_tree_reclaimer&);
+
+	void run();
+
+	mutable std::mutex m_mutex;
+	// signals the thread that a job arrived or it should stop
+	std::condition_variable m_work;
+	// signals drain() that a job finished
+	std::condition_variable m_done;
+	std::deque<job> m_jobs;
+	// the job the thread is running, counted in pending()
+	std::size_t m_running;
+	bool m_stop;
+	std::thread m_thread;
+};
+
+inline radix_tree_reclaimer::radix_tree_reclaimer() :m_running(0), m_stop(false)
+{
+	// started last, once every member it reads is initialized
+	m_thread = std::thread([this]() { run(); });
+}
+
+inline radix_tree_reclaimer::~radix_tree_reclaimer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_work.notify_one();
+	m_thread.join();
+}
+
+inline void radix_tree_reclaimer::defer(void* p, void (*work)(void*))
+{
+	job j = { p, work };
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(j);
+	}
+	m_work.notify_one();
+}
+
+inline void radix_tree_reclaimer::drain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_jobs.empty() && m_running == 0; });
+}
+
+inline std::size_t radix_tree_reclaimer::pending() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_jobs.size() + m_running;
+}
+
+inline void radix_tree_reclaimer::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_work.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+		// jobs still queued are run before stopping
+		if (m_jobs.empty())
+			break;
+
+		job j = m_jobs.front();
+		m_jobs.pop_front();
+		m_running = 1;
+		lock.unlock();
+		j.work(j.p);
+		lock.lock();
+		m_running = 0;
+		m_done.notify_all();
+	}
+}
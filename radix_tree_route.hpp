@@ -0,0 +1,419 @@
+#pragma once
+#include<cassert>
+#include<cstddef>
+#include<cstdint>
+#include<map>
+#include<utility>
+#include<vector>
+
+// 128-bit address in two halves, hi holding the leading bits, for IPv6 routes
+struct radix_uint128 {
+	radix_uint128() :hi(0), lo(0) { }
+	radix_uint128(std::uint64_t h, std::uint64_t l) :hi(h), lo(l) { }
+
+	std::uint64_t hi;
+	std::uint64_t lo;
+};
+
+inline bool operator==(const radix_uint128& a, const radix_uint128& b) { return a.hi == b.hi && a.lo == b.lo; }
+inline bool operator<(const radix_uint128& a, const radix_uint128& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+
+// Bit access for the address types of radix_route_table; bits are numbered from
+// the most significant one, as prefix lengths count them.
+template<typename Addr>
+struct radix_route_key;
+
+template<>
+struct radix_route_key<std::uint32_t> {
+	enum { bits = 32 };
+	// the width bits starting offset bits below the top, 0 < width <= 32
+	static unsigned extract(std::uint32_t a, int offset, int width) { return static_cast<std::uint32_t>(a << offset) >> (32 - width); }
+	// a with every bit after the first len cleared
+	static std::uint32_t mask(std::uint32_t a, int len) { return len == 0 ? 0 : a & (~std::uint32_t(0) << (32 - len)); }
+};
+
+template<>
+struct radix_route_key<radix_uint128> {
+	enum { bits = 128 };
+	static unsigned extract(const radix_uint128& a, int offset, int width) {
+		std::uint64_t top = offset == 0 ? a.hi : offset < 64 ? (a.hi << offset) | (a.lo >> (64 - offset)) : a.lo << (offset - 64);
+		return static_cast<unsigned>(top >> (64 - width));
+	}
+	static radix_uint128 mask(const radix_uint128& a, int len) {
+		std::uint64_t hi = len >= 64 ? ~std::uint64_t(0) : len == 0 ? 0 : ~std::uint64_t(0) << (64 - len);
+		std::uint64_t lo = len <= 64 ? 0 : ~std::uint64_t(0) << (128 - len);
+		return radix_uint128(a.hi & hi, a.lo & lo);
+	}
+};
+
+// Longest-prefix match over fixed-width addresses with bit-granular prefix
+// lengths, for routing tables. The string radix_tree branches on whole bytes and
+// compares edge labels; here the address is cut into the compile-time Strides,
+// and every level is a table indexed directly by the next stride of bits
+// (controlled prefix expansion). A prefix ending inside a stride is copied to all
+// the entries it covers, a longer prefix taking precedence over a shorter one,
+// so a lookup is one indexed load per level until an entry has no child, keeping
+// the last route seen, with no comparison of labels and no allocation.
+//
+// The tables of one level are blocks of a flat vector, linked by block number,
+// and blocks left empty by erase are reused. Routes themselves are kept densely,
+// with an ordered index of (prefix, length) for exact lookups and to find the
+// route that takes over the entries of an erased one. Updates cost up to
+// 2^(stride - 1) entry writes; short strides at the deep levels keep that and the
+// memory of sparse blocks small.
+template<typename Addr, typename T, int... Strides>
+class radix_route_table {
+public:
+	typedef Addr address_type;
+	typedef T mapped_type;
+	typedef std::size_t size_type;
+	typedef radix_route_key<Addr> key_traits;
+
+	enum { levels = sizeof...(Strides) };
+
+	static_assert(levels > 0, "at least one stride");
+	static_assert((0 + ... + Strides) == key_traits::bits, "the strides must add up to the address width");
+	// a level's table has 2^stride entries and is indexed by a 32-bit block number
+	static_assert((true && ... && (Strides > 0 && Strides <= 24)), "every stride takes 1 to 24 bits");
+
+	radix_route_table() :m_default(0) { clear(); }
+
+	size_type size() const { return m_routes.size(); }
+	bool empty() const { return m_routes.empty(); }
+	void clear();
+	// memory held by the level tables and the routes, the index estimated per entry
+	size_type bytes() const;
+
+	// adds prefix/len; bits of prefix after the first len are ignored. Returns
+	// false, leaving the stored value alone, when the route is already there
+	bool insert(const Addr& prefix, int len, const T& value);
+	bool erase(const Addr& prefix, int len);
+	// the value of exactly prefix/len, NULL when there is none
+	T* find(const Addr& prefix, int len);
+	const T* find(const Addr& prefix, int len) const { return const_cast<radix_route_table*>(this)->find(prefix, len); }
+	// the value of the longest prefix containing addr, NULL when there is none;
+	// match_len, when given, receives its length
+	const T* longest_match(const Addr& addr, int* match_len = NULL) const;
+	// calls visit(prefix, len, value) on every route in (prefix, length) order
+	template<class Visitor> void for_each(Visitor visit) const;
+private:
+	static const int strides[levels];
+
+	// child is the block number of the next level's table plus one, route the
+	// index of the route plus one, 0 meaning none for both
+	struct entry {
+		std::uint32_t child;
+		std::uint32_t route;
+	};
+	struct route {
+		Addr prefix;
+		int len;
+		T value;
+	};
+	typedef std::map<std::pair<Addr, int>, std::uint32_t> index_type;
+
+	// the level whose table holds a prefix of len bits, 0 < len
+	static int level_of(int len);
+	entry* table(int level, std::uint32_t block) { return &m_tables[level][static_cast<std::size_t>(block) << strides[level]]; }
+	const entry* table(int level, std::uint32_t block) const { return &m_tables[level][static_cast<std::size_t>(block) << strides[level]]; }
+	std::uint32_t new_block(int level);
+	// the table holding prefix/len, NULL when a table on the way is missing;
+	// path receives the blocks from the root down to it
+	entry* locate(const Addr& prefix, int len, std::uint32_t* path);
+	// sets the entries that prefix/len expands to from route from to route to
+	void replace(const Addr& prefix, int len, entry* t, std::uint32_t from, std::uint32_t to);
+
+	std::vector<entry> m_tables[levels];
+	// routes stored in a block plus its children, the block is freed at zero
+	std::vector<std::uint32_t> m_counts[levels];
+	std::vector<std::uint32_t> m_free[levels];
+	std::vector<route> m_routes;
+	index_type m_index;
+	// the route of length 0, plus one
+	std::uint32_t m_default;
+};
+
+template<typename Addr, typename T, int... Strides>
+const int radix_route_table<Addr, T, Strides...>::strides[radix_route_table<Addr, T, Strides...>::levels] = { Strides... };
+
+template<typename Addr, typename T, int... Strides>
+int radix_route_table<Addr, T, Strides...>::level_of(int len)
+{
+	int end = 0;
+	int l = 0;
+
+	for (; l < levels; l++) {
+		end += strides[l];
+		if (len <= end)
+			break;
+	}
+
+	return l;
+}
+
+template<typename Addr, typename T, int... Strides>
+void radix_route_table<Addr, T, Strides...>::clear()
+{
+	for (int l = 0; l < levels; l++) {
+		m_tables[l].clear();
+		m_counts[l].clear();
+		m_free[l].clear();
+	}
+	m_routes.clear();
+	m_index.clear();
+	m_default = 0;
+	// the root table always exists
+	new_block(0);
+}
+
+template<typename Addr, typename T, int... Strides>
+std::uint32_t radix_route_table<Addr, T, Strides...>::new_block(int level)
+{
+	std::uint32_t block;
+
+	if (!m_free[level].empty()) {
+		block = m_free[level].back();
+		m_free[level].pop_back();
+	}
+	else {
+		block = static_cast<std::uint32_t>(m_counts[level].size());
+		m_counts[level].push_back(0);
+		entry empty = { 0, 0 };
+		m_tables[level].resize(m_tables[level].size() + (std::size_t(1) << strides[level]), empty);
+	}
+
+	return block;
+}
+
+template<typename Addr, typename T, int... Strides>
+typename radix_route_table<Addr, T, Strides...>::size_type radix_route_table<Addr, T, Strides...>::bytes() const
+{
+	// a red-black tree node is about four pointers on top of its value
+	size_type total = sizeof(*this) + m_routes.capacity() * sizeof(route) + m_index.size() * (sizeof(typename index_type::value_type) + 4 * sizeof(void*));
+
+	for (int l = 0; l < levels; l++)
+		total += m_tables[l].capacity() * sizeof(entry) + (m_counts[l].capacity() + m_free[l].capacity()) * sizeof(std::uint32_t);
+
+	return total;
+}
+
+template<typename Addr, typename T, int... Strides>
+typename radix_route_table<Addr, T, Strides...>::entry* radix_route_table<Addr, T, Strides...>::locate(const Addr& prefix, int len, std::uint32_t* path)
+{
+	int level = level_of(len);
+	int offset = 0;
+	std::uint32_t block = 0;
+
+	for (int l = 0; l < level; l++) {
+		path[l] = block;
+		entry& e = table(l, block)[key_traits::extract(prefix, offset, strides[l])];
+		if (e.child == 0)
+			return NULL;
+		block = e.child - 1;
+		offset += strides[l];
+	}
+	path[level] = block;
+
+	return table(level, block);
+}
+
+template<typename Addr, typename T, int... Strides>
+void radix_route_table<Addr, T, Strides...>::replace(const Addr& prefix, int len, entry* t, std::uint32_t from, std::uint32_t to)
+{
+	int level = level_of(len);
+	int offset = 0;
+
+	for (int l = 0; l < level; l++)
+		offset += strides[l];
+
+	// prefix/len covers the entries that agree with it on its len - offset bits in this table
+	int free_bits = offset + strides[level] - len;
+	std::size_t first = key_traits::extract(prefix, offset, strides[level]) & ~((std::size_t(1) << free_bits) - 1);
+	std::size_t last = first + (std::size_t(1) << free_bits);
+
+	for (std::size_t i = first; i < last; i++) {
+		if (t[i].route == from)
+			t[i].route = to;
+	}
+}
+
+template<typename Addr, typename T, int... Strides>
+bool radix_route_table<Addr, T, Strides...>::insert(const Addr& prefix, int len, const T& value)
+{
+	assert(len >= 0 && len <= key_traits::bits);
+
+	Addr p = key_traits::mask(prefix, len);
+	std::pair<Addr, int> key(p, len);
+	typename index_type::iterator hint = m_index.lower_bound(key);
+	if (hint != m_index.end() && !(key < hint->first))
+		return false;
+
+	// everything that can throw comes first and is undone on a throw: the route, its
+	// index entry and the missing tables down to the level of the prefix. A table
+	// made before the throw stays linked, empty, and is used by the next insert there
+	route r = { p, len, value };
+	m_routes.push_back(r);
+	std::uint32_t id = static_cast<std::uint32_t>(m_routes.size());
+	int level = level_of(len);
+	bool indexed = false;
+	try {
+		hint = m_index.insert(hint, std::make_pair(key, id - 1));
+		indexed = true;
+		int offset = 0;
+		std::uint32_t block = 0;
+		for (int l = 0; l < level; l++) {
+			entry& e = table(l, block)[key_traits::extract(p, offset, strides[l])];
+			if (e.child == 0)
+				e.child = new_block(l + 1) + 1;
+			block = e.child - 1;
+			offset += strides[l];
+		}
+	}
+	catch (...) {
+		if (indexed)
+			m_index.erase(hint);
+		m_routes.pop_back();
+		throw;
+	}
+
+	if (len == 0) {
+		m_default = id;
+		return true;
+	}
+
+	int offset = 0;
+	std::uint32_t block = 0;
+	for (int l = 0; l < level; l++) {
+		m_counts[l][block]++;
+		block = table(l, block)[key_traits::extract(p, offset, strides[l])].child - 1;
+		offset += strides[l];
+	}
+	m_counts[level][block]++;
+
+	// a longer prefix already in an entry stays, the new one is longer than any other
+	int free_bits = offset + strides[level] - len;
+	std::size_t first = key_traits::extract(p, offset, strides[level]) & ~((std::size_t(1) << free_bits) - 1);
+	std::size_t last = first + (std::size_t(1) << free_bits);
+	entry* t = table(level, block);
+	for (std::size_t i = first; i < last; i++) {
+		if (t[i].route == 0 || m_routes[t[i].route - 1].len < len)
+			t[i].route = id;
+	}
+
+	return true;
+}
+
+template<typename Addr, typename T, int... Strides>
+bool radix_route_table<Addr, T, Strides...>::erase(const Addr& prefix, int len)
+{
+	assert(len >= 0 && len <= key_traits::bits);
+
+	Addr p = key_traits::mask(prefix, len);
+	typename index_type::iterator it = m_index.find(std::make_pair(p, len));
+	if (it == m_index.end())
+		return false;
+
+	std::uint32_t id = it->second + 1;
+	m_index.erase(it);
+	if (len == 0) {
+		m_default = 0;
+	}
+	else {
+		std::uint32_t path[levels];
+		int level = level_of(len);
+		entry* t = locate(p, len, path);
+		assert(t != NULL);
+
+		// the entries go to the longest shorter prefix ending in the same table, if any;
+		// shorter ones in the tables above are picked up on the way down
+		int offset = 0;
+		for (int l = 0; l < level; l++)
+			offset += strides[l];
+		std::uint32_t cover = 0;
+		for (int l = len - 1; l > offset && cover == 0; l--) {
+			typename index_type::const_iterator c = m_index.find(std::make_pair(key_traits::mask(p, l), l));
+			if (c != m_index.end())
+				cover = c->second + 1;
+		}
+		replace(p, len, t, id, cover);
+
+		// frees the tables left without routes, from the bottom up; their entries are all clear by now
+		for (int l = level; l > 0; l--) {
+			offset -= strides[l - 1];
+			if (--m_counts[l][path[l]] == 0) {
+				m_free[l].push_back(path[l]);
+				table(l - 1, path[l - 1])[key_traits::extract(p, offset, strides[l - 1])].child = 0;
+			}
+		}
+		m_counts[0][0]--;
+	}
+
+	// moves the last route into the hole, renumbering its entries
+	std::uint32_t moved = static_cast<std::uint32_t>(m_routes.size());
+	if (id != moved) {
+		route& r = m_routes[moved - 1];
+		m_index[std::make_pair(r.prefix, r.len)] = id - 1;
+		if (r.len == 0) {
+			m_default = id;
+		}
+		else {
+			// only the entries it expands to can hold it
+			std::uint32_t path[levels];
+			replace(r.prefix, r.len, locate(r.prefix, r.len, path), moved, id);
+		}
+		m_routes[id - 1] = r;
+	}
+	m_routes.pop_back();
+
+	return true;
+}
+
+template<typename Addr, typename T, int... Strides>
+T* radix_route_table<Addr, T, Strides...>::find(const Addr& prefix, int len)
+{
+	typename index_type::iterator it = m_index.find(std::make_pair(key_traits::mask(prefix, len), len));
+
+	return it != m_index.end() ? &m_routes[it->second].value : NULL;
+}
+
+template<typename Addr, typename T, int... Strides>
+const T* radix_route_table<Addr, T, Strides...>::longest_match(const Addr& addr, int* match_len) const
+{
+	std::uint32_t best = m_default;
+	std::uint32_t block = 0;
+	int offset = 0;
+
+	for (int l = 0; l < levels; l++) {
+		const entry& e = table(l, block)[key_traits::extract(addr, offset, strides[l])];
+		if (e.route != 0)
+			best = e.route;
+		if (e.child == 0)
+			break;
+		block = e.child - 1;
+		offset += strides[l];
+	}
+
+	if (best == 0)
+		return NULL;
+	if (match_len != NULL)
+		*match_len = m_routes[best - 1].len;
+
+	return &m_routes[best - 1].value;
+}
+
+template<typename Addr, typename T, int... Strides>
+template<class Visitor>
+void radix_route_table<Addr, T, Strides...>::for_each(Visitor visit) const
+{
+	for (typename index_type::const_iterator it = m_index.begin(); it != m_index.end(); ++it) {
+		const route& r = m_routes[it->second];
+		visit(r.prefix, r.len, r.value);
+	}
+}
+
+// the classic 16-8-8 split for IPv4: most routes are /24 or shorter and take at most two steps
+template<typename T>
+using radix_ipv4_table = radix_route_table<std::uint32_t, T, 16, 8, 8>;
+// IPv6 routes are /48 or shorter almost throughout; 8-bit strides after the first 16 keep the sparse blocks small
+template<typename T>
+using radix_ipv6_table = radix_route_table<radix_uint128, T, 16, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8>;
@@ -0,0 +1,271 @@
+#pragma once
+#include<algorithm>
+#include<cstddef>
+#include<cstring>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<utility>
+#include<vector>
+
+#include "radix_tree.hpp"
+
+// maps the leading bytes of a key, key[0, len), to one of shards trees
+typedef std::size_t (*radix_shard_function)(const char* key, int len, std::size_t shards);
+
+// ranges of the first byte, so shard order follows key order; the empty key goes to shard 0
+inline std::size_t radix_shard_by_byte(const char* key, int len, std::size_t shards)
+{
+	return len == 0 ? 0 : static_cast<unsigned char>(key[0]) * shards / 256;
+}
+
+// FNV-1a over the leading bytes, for key sets that crowd into a few first bytes
+inline std::size_t radix_shard_by_hash(const char* key, int len, std::size_t shards)
+{
+	std::size_t h = 2166136261u;
+
+	for (int i = 0; i < len; i++)
+		h = (h ^ static_cast<unsigned char>(key[i])) * 16777619u;
+
+	return h % shards;
+}
+
+// A front end that splits the key space over independent radix_trees, each with
+// its own lock and its own radix_tree_pool, so writers on different shards never
+// contend. A key goes to the shard picked by the shard function from its first
+// prefix_bytes bytes. A prefix at least that long therefore lives in one shard
+// and prefix_match asks only that one; shorter prefixes ask every shard and merge.
+// longest_match asks the shard of the key and looks up the few shorter prefixes
+// that may sit elsewhere. Results are copies, since an iterator into a shard is
+// only good while its lock is held. for_each locks all shards and merges them in
+// key order.
+template<typename K, typename T, typename Compare = std::less<K> >
+class sharded_radix_tree {
+public:
+	typedef K key_type;
+	typedef T mapped_type;
+	typedef std::pair<const K, T> value_type;
+	typedef std::size_t size_type;
+	typedef radix_tree<K, T, Compare> shard_type;
+
+	explicit sharded_radix_tree(std::size_t shards = 16, int prefix_bytes = 1, radix_shard_function function = radix_shard_by_byte);
+
+	size_type shards() const { return m_count; }
+	size_type size() const;
+	bool empty() const { return size() == 0; }
+	void clear();
+
+	bool insert(const value_type& val);
+	bool erase(const K& key) { return erase(radix_data(key), radix_length(key)); }
+	bool find(const K& key, T& value) const { return find(radix_data(key), radix_length(key), value); }
+	bool longest_match(const K& key, K& match, T& value) const { return longest_match(radix_data(key), radix_length(key), match, value); }
+	// copies of every element whose key starts with key, in key order
+	void prefix_match(const K& key, std::vector<value_type>& vec) const { prefix_match(radix_data(key), radix_length(key), vec); }
+
+	bool erase(const char* key, int len);
+	bool find(const char* key, int len, T& value) const;
+	bool longest_match(const char* key, int len, K& match, T& value) const;
+	void prefix_match(const char* key, int len, std::vector<value_type>& vec) const;
+	// calls visit on every element in key order until it returns false; all shards stay locked meanwhile
+	template<class Visitor> void for_each(Visitor visit) const;
+private:
+	typedef typename shard_type::const_iterator const_iterator;
+	struct alignas(64) shard {
+		mutable std::mutex m_mutex;
+		shard_type m_tree;
+	};
+	// keys of the trees are ordered bytewise, whatever Compare says
+	static bool key_less(const K& a, const K& b);
+	// merges the [first, last) ranges of every shard in key order, visit returns false to stop
+	template<class Visitor> static void merge(std::vector<std::pair<const_iterator, const_iterator> >& ranges, Visitor& visit);
+
+	sharded_radix_tree(const sharded_radix_tree&);
+	sharded_radix_tree& operator=(const sharded_radix_tree&);
+
+	shard& owner(const char* key, int len) const { return m_shards[m_shard(key, len < m_prefix_bytes ? len : m_prefix_bytes, m_count)]; }
+
+	std::size_t m_count;
+	int m_prefix_bytes;
+	radix_shard_function m_shard;
+	std::unique_ptr<shard[]> m_shards;
+};
+
+template<typename K, typename T, typename Compare>
+sharded_radix_tree<K, T, Compare>::sharded_radix_tree(std::size_t shards, int prefix_bytes, radix_shard_function function) :
+	m_count(shards == 0 ? 1 : shards),
+	m_prefix_bytes(prefix_bytes),
+	m_shard(function),
+	m_shards(new shard[shards == 0 ? 1 : shards])
+{
+}
+
+template<typename K, typename T, typename Compare>
+typename sharded_radix_tree<K, T, Compare>::size_type sharded_radix_tree<K, T, Compare>::size() const
+{
+	size_type total = 0;
+
+	for (std::size_t i = 0; i < m_count; i++) {
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		total += m_shards[i].m_tree.size();
+	}
+
+	return total;
+}
+
+template<typename K, typename T, typename Compare>
+void sharded_radix_tree<K, T, Compare>::clear()
+{
+	for (std::size_t i = 0; i < m_count; i++) {
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		m_shards[i].m_tree.clear();
+	}
+}
+
+template<typename K, typename T, typename Compare>
+bool sharded_radix_tree<K, T, Compare>::insert(const value_type& val)
+{
+	shard& s = owner(radix_data(val.first), radix_length(val.first));
+	std::lock_guard<std::mutex> lock(s.m_mutex);
+
+	return s.m_tree.insert(val).second;
+}
+
+template<typename K, typename T, typename Compare>
+bool sharded_radix_tree<K, T, Compare>::erase(const char* key, int len)
+{
+	shard& s = owner(key, len);
+	std::lock_guard<std::mutex> lock(s.m_mutex);
+
+	return s.m_tree.erase(key, len);
+}
+
+template<typename K, typename T, typename Compare>
+bool sharded_radix_tree<K, T, Compare>::find(const char* key, int len, T& value) const
+{
+	shard& s = owner(key, len);
+	std::lock_guard<std::mutex> lock(s.m_mutex);
+	typename shard_type::iterator it = s.m_tree.find(key, len);
+
+	if (it == s.m_tree.end())
+		return false;
+
+	value = it->second;
+
+	return true;
+}
+
+template<typename K, typename T, typename Compare>
+bool sharded_radix_tree<K, T, Compare>::longest_match(const char* key, int len, K& match, T& value) const
+{
+	int routed = len < m_prefix_bytes ? len : m_prefix_bytes;
+	int best = -1;
+
+	{
+		shard& s = owner(key, len);
+		std::lock_guard<std::mutex> lock(s.m_mutex);
+		typename shard_type::iterator it = s.m_tree.longest_match(key, len);
+		if (it != s.m_tree.end()) {
+			match = it->first;
+			value = it->second;
+			best = radix_length(it->first);
+		}
+	}
+
+	// prefixes shorter than the routing bytes are placed by their own bytes and may be in other shards
+	for (int l = routed - 1; l > best; l--) {
+		shard& s = owner(key, l);
+		std::lock_guard<std::mutex> lock(s.m_mutex);
+		typename shard_type::iterator it = s.m_tree.find(key, l);
+		if (it != s.m_tree.end()) {
+			match = it->first;
+			value = it->second;
+			return true;
+		}
+	}
+
+	return best >= 0;
+}
+
+template<typename K, typename T, typename Compare>
+void sharded_radix_tree<K, T, Compare>::prefix_match(const char* key, int len, std::vector<value_type>& vec) const
+{
+	vec.clear();
+
+	if (len >= m_prefix_bytes) {
+		shard& s = owner(key, len);
+		std::lock_guard<std::mutex> lock(s.m_mutex);
+		typename shard_type::range r = s.m_tree.prefix_range(key, len);
+		for (typename shard_type::iterator it = r.begin(); it != r.end(); ++it)
+			vec.push_back(*it);
+		return;
+	}
+
+	std::vector<std::unique_lock<std::mutex> > locks;
+	std::vector<std::pair<const_iterator, const_iterator> > ranges;
+
+	for (std::size_t i = 0; i < m_count; i++) {
+		locks.push_back(std::unique_lock<std::mutex>(m_shards[i].m_mutex));
+		typename shard_type::range r = m_shards[i].m_tree.prefix_range(key, len);
+		ranges.push_back(std::make_pair(const_iterator(r.begin()), const_iterator(r.end())));
+	}
+
+	auto collect = [&vec](const value_type& val) { vec.push_back(val); return true; };
+	merge(ranges, collect);
+}
+
+template<typename K, typename T, typename Compare>
+template<class Visitor>
+void sharded_radix_tree<K, T, Compare>::for_each(Visitor visit) const
+{
+	std::vector<std::unique_lock<std::mutex> > locks;
+	std::vector<std::pair<const_iterator, const_iterator> > ranges;
+
+	// always in shard order, so two callers cannot deadlock
+	for (std::size_t i = 0; i < m_count; i++) {
+		locks.push_back(std::unique_lock<std::mutex>(m_shards[i].m_mutex));
+		const shard_type& tree = m_shards[i].m_tree;
+		ranges.push_back(std::make_pair(tree.begin(), tree.end()));
+	}
+
+	merge(ranges, visit);
+}
+
+template<typename K, typename T, typename Compare>
+bool sharded_radix_tree<K, T, Compare>::key_less(const K& a, const K& b)
+{
+	int len_a = radix_length(a);
+	int len_b = radix_length(b);
+	int n = len_a < len_b ? len_a : len_b;
+	int count = radix_mismatch(radix_data(a), radix_data(b), n);
+
+	if (count == n)
+		return len_a < len_b;
+
+	return static_cast<unsigned char>(radix_data(a)[count]) < static_cast<unsigned char>(radix_data(b)[count]);
+}
+
+template<typename K, typename T, typename Compare>
+template<class Visitor>
+void sharded_radix_tree<K, T, Compare>::merge(std::vector<std::pair<const_iterator, const_iterator> >& ranges, Visitor& visit)
+{
+	// min-heap of the shards that still have elements, keyed by their current element
+	std::vector<std::size_t> heap;
+	auto greater = [&ranges](std::size_t a, std::size_t b) { return key_less(ranges[b].first->first, ranges[a].first->first); };
+
+	for (std::size_t i = 0; i < ranges.size(); i++) {
+		if (ranges[i].first != ranges[i].second)
+			heap.push_back(i);
+	}
+	std::make_heap(heap.begin(), heap.end(), greater);
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), greater);
+		std::size_t i = heap.back();
+		if (!visit(*ranges[i].first))
+			return;
+		if (++ranges[i].first != ranges[i].second)
+			std::push_heap(heap.begin(), heap.end(), greater);
+		else
+			heap.pop_back();
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include<cstring>
+
+// Byte kernels on the lookup and insert paths: the first mismatch between a key
+// and an edge label, and the search over the 16 sorted key bytes of a node16.
+// The instruction set is picked at compile time: AVX2 when the compiler targets
+// it (-mavx2, /arch:AVX2), SSE2 on any x86-64 build, plain loops elsewhere.
+#if defined(__AVX2__)
+#include<immintrin.h>
+#define RADIX_TREE_SSE2
+#define RADIX_TREE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define RADIX_TREE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include<intrin.h>
+#endif
+
+inline int radix_ctz(unsigned int mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+inline int radix_ctz64(unsigned long long mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return static_cast<int>(index);
+#elif defined(_MSC_VER)
+	unsigned int low = static_cast<unsigned int>(mask);
+	return low != 0 ? radix_ctz(low) : 32 + radix_ctz(static_cast<unsigned int>(mask >> 32));
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+// hint that p will be read soon; a no-op where the compiler has no prefetch intrinsic
+inline void radix_prefetch(const void* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(p);
+#elif defined(RADIX_TREE_SSE2)
+	_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+	(void)p;
+#endif
+}
+
+inline int radix_popcount64(unsigned long long mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<int>(__popcnt64(mask));
+#elif defined(_MSC_VER)
+	return static_cast<int>(__popcnt(static_cast<unsigned int>(mask)) + __popcnt(static_cast<unsigned int>(mask >> 32)));
+#else
+	return __builtin_popcountll(mask);
+#endif
+}
+
+// index of the first byte where a[0, n) and b[0, n) differ, n when they are equal
+inline int radix_mismatch(const char* a, const char* b, int n)
+{
+	int i = 0;
+
+#if defined(RADIX_TREE_AVX2)
+	for (; i + 32 <= n; i += 32) {
+		__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		unsigned int eq = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+		if (eq != 0xFFFFFFFFu)
+			return i + radix_ctz(~eq);
+	}
+#endif
+#if defined(RADIX_TREE_SSE2)
+	for (; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		unsigned int eq = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+		if (eq != 0xFFFFu)
+			return i + radix_ctz(~eq & 0xFFFFu);
+	}
+	if (i < n && n >= 16) {
+		// finish with one overlapping load instead of a byte loop
+		int j = n - 16;
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + j));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+		unsigned int eq = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+		return eq != 0xFFFFu ? j + radix_ctz(~eq & 0xFFFFu) : n;
+	}
+	// short labels: x86 is little-endian, so the lowest set bit of the xor lies in the first differing byte
+	if (i + 8 <= n) {
+		unsigned long long wa, wb;
+		memcpy(&wa, a + i, 8);
+		memcpy(&wb, b + i, 8);
+		if (wa != wb)
+			return i + (radix_ctz64(wa ^ wb) >> 3);
+		i += 8;
+	}
+	if (i + 4 <= n) {
+		unsigned int wa, wb;
+		memcpy(&wa, a + i, 4);
+		memcpy(&wb, b + i, 4);
+		if (wa != wb)
+			return i + (radix_ctz(wa ^ wb) >> 3);
+		i += 4;
+	}
+#else
+	for (; i + 4 <= n; i += 4) {
+		unsigned int wa, wb;
+		memcpy(&wa, a + i, 4);
+		memcpy(&wb, b + i, 4);
+		if (wa != wb)
+			break;
+	}
+#endif
+	for (; i < n; i++) {
+		if (a[i] != b[i])
+			break;
+	}
+
+	return i;
+}
+
+inline bool radix_equal(const char* a, const char* b, int n)
+{
+	return radix_mismatch(a, b, n) == n;
+}
+
+// position of c among the first n bytes of a 16-byte key array, -1 when absent
+inline int radix_find16(const unsigned char* keys, int n, unsigned char c)
+{
+#if defined(RADIX_TREE_SSE2)
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+	unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(c)))));
+	mask &= (1u << n) - 1;
+	return mask != 0 ? radix_ctz(mask) : -1;
+#else
+	for (int i = 0; i < n; i++) {
+		if (keys[i] == c)
+			return i;
+	}
+	return -1;
+#endif
+}
+
+// position of the first of the n sorted bytes of a 16-byte key array that is greater than c, n when none is
+inline int radix_upper16(const unsigned char* keys, int n, unsigned char c)
+{
+#if defined(RADIX_TREE_SSE2)
+	// SSE2 has no unsigned byte compare: keys[i] <= c exactly when max(keys[i], c) == c
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+	__m128i vc = _mm_set1_epi8(static_cast<char>(c));
+	unsigned int le = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, vc), vc)));
+	unsigned int gt = ~le & ((1u << n) - 1);
+	return gt != 0 ? radix_ctz(gt) : n;
+#else
+	int i;
+	for (i = 0; i < n && keys[i] <= c; i++)
+		;
+	return i;
+#endif
+}
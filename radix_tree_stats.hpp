@@ -0,0 +1,68 @@
+#pragma once
+#include<cstddef>
+#include<vector>
+
+// Hot-path counters are compiled in only with RADIX_TREE_COUNTERS defined; without
+// it RADIX_TREE_COUNT expands to nothing and radix_tree::counters() reads zeros.
+// With it every counted event is one increment of a plain integer in the tree or
+// its pool, cheap enough to leave on; like the rest of the tree they are not
+// synchronized, so read them from the thread that owns the tree.
+#ifdef RADIX_TREE_COUNTERS
+#define RADIX_TREE_COUNT(counter) (++(counter))
+#else
+#define RADIX_TREE_COUNT(counter) ((void)0)
+#endif
+
+// Shape of a radix_tree at one moment, filled in by radix_tree::stats() in one walk
+// over the nodes. Depths count levels below the root, not key bytes.
+struct radix_tree_stats {
+	enum { max_label_length = 64 };
+
+	std::size_t nodes;
+	// nodes without children
+	std::size_t leaves;
+	std::size_t values;
+	// depths[d] nodes lie d levels below the root
+	std::vector<std::size_t> depths;
+	// fanout[c] nodes have c children, 0 to 256
+	std::vector<std::size_t> fanout;
+	// label_lengths[l] edge labels are l bytes long; the last entry counts every label of max_label_length bytes or more
+	std::vector<std::size_t> label_lengths;
+	// edge labels short enough to be kept inside their node, which take no label_bytes
+	std::size_t inline_labels;
+	// bytes taken by the nodes, their child indexes and the edge labels kept in the pool,
+	// a label counted as the whole block the pool hands out for it
+	std::size_t node_bytes;
+	std::size_t child_bytes;
+	std::size_t label_bytes;
+	// bytes the pooled labels would take packed back to back in one append-only arena; a
+	// floor, since such an arena cannot reuse the space of labels later split or joined
+	std::size_t label_arena_bytes;
+	// bytes held by the pool, free blocks and the unused end of the last chunk included;
+	// for a pool shared with other trees it covers all of them
+	std::size_t pool_bytes;
+	// estimate of the heap the tree holds: the pool when the tree owns it, otherwise
+	// the sum above; memory a key or value allocates on its own is not included
+	std::size_t heap_bytes;
+
+	radix_tree_stats() :nodes(0), leaves(0), values(0), depths(), fanout(257, 0), label_lengths(max_label_length + 1, 0),
+		inline_labels(0), node_bytes(0), child_bytes(0), label_bytes(0), label_arena_bytes(0), pool_bytes(0), heap_bytes(0) { }
+};
+
+// Events on the hot paths since the tree was made or reset_counters() was called.
+struct radix_tree_counters {
+	// lookups descend from the root, every find, insert, erase and match does one
+	std::size_t lookups;
+	// nodes a lookup stepped into below the root, levels / lookups is the average path length
+	std::size_t levels;
+	std::size_t inserts;
+	// inserts that had to split an edge label
+	std::size_t splits;
+	std::size_t erases;
+	// erases that merged a node without value into its only child
+	std::size_t merges;
+	// requests to the tree's pool, allocations / (inserts + erases) is the allocation rate of the writes
+	std::size_t allocations;
+
+	radix_tree_counters() :lookups(0), levels(0), inserts(0), splits(0), erases(0), merges(0), allocations(0) { }
+};
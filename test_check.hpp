@@ -0,0 +1,25 @@
+#pragma once
+#include<cstdio>
+
+// Minimal checks for the test programs run by ctest. A failed CHECK reports the
+// expression and its place and the run goes on, so one run shows every failure;
+// test_exit() turns the tally into the exit status.
+static int test_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			test_failures++; \
+		} \
+	} while (0)
+
+inline int test_exit(const char* name)
+{
+	if (test_failures != 0) {
+		std::fprintf(stderr, "%s: %d checks failed\n", name, test_failures);
+		return 1;
+	}
+	std::printf("%s: ok\n", name);
+	return 0;
+}
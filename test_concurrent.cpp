@@ -0,0 +1,252 @@
+// Checks concurrent_radix_tree and sharded_radix_tree: writers on disjoint key
+// sets race with readers that check every result they see, then the final
+// contents are compared with std::map, single threaded.
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "radix_tree_concurrent.hpp"
+#include "radix_tree_sharded.hpp"
+#include "test_check.hpp"
+
+typedef std::map<std::string, std::string> map_type;
+
+static const int writers = 4;
+static const int readers = 2;
+
+// keys sharing prefixes, so that writers split and merge the same nodes
+static std::vector<std::string> make_keys(std::size_t n)
+{
+	std::mt19937 rng(777);
+	std::set<std::string> keys;
+	while (keys.size() < n) {
+		std::string key;
+		int len = 1 + rng() % (rng() % 8 == 0 ? 30 : 8);
+		for (int i = 0; i < len; i++)
+			key += "abcd\x80"[rng() % 5];
+		keys.insert(key);
+	}
+	std::vector<std::string> v(keys.begin(), keys.end());
+	std::shuffle(v.begin(), v.end(), rng);
+	return v;
+}
+
+static bool starts_with(const std::string& key, const std::string& prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+// every value is its own key, so a reader can tell a torn or misplaced result
+template<class Tree>
+static void read_loop(const Tree& tree, const std::vector<std::string>& keys, const std::atomic<bool>& done, int& bad)
+{
+	std::vector<std::pair<const std::string, std::string> > vec;
+	std::size_t i = 0;
+	while (!done) {
+		const std::string& key = keys[i++ % keys.size()];
+		std::string value, match;
+		if (tree.find(key, value) && value != key)
+			bad++;
+		if (tree.longest_match(key + "x", match, value) && (value != match || !starts_with(key, match)))
+			bad++;
+		tree.prefix_match(key.substr(0, 2), vec);
+		for (std::size_t j = 0; j < vec.size(); j++) {
+			if (vec[j].first != vec[j].second || !starts_with(vec[j].first, key.substr(0, 2)))
+				bad++;
+			if (j != 0 && !(vec[j - 1].first < vec[j].first))
+				bad++;
+		}
+	}
+}
+
+// writer w inserts its share of keys and erases every other one of them again
+template<class Tree>
+static void write_loop(Tree& tree, const std::vector<std::string>& keys, int w, int& bad)
+{
+	for (std::size_t i = w; i < keys.size(); i += writers) {
+		if (!tree.insert(std::make_pair(keys[i], keys[i])))
+			bad++;
+	}
+	for (std::size_t i = w; i < keys.size(); i += 2 * writers) {
+		if (!tree.erase(keys[i]))
+			bad++;
+	}
+}
+
+template<class Tree>
+static void run_threads(Tree& tree, const std::vector<std::string>& keys)
+{
+	std::atomic<bool> done(false);
+	std::vector<int> bad(writers + readers);
+	std::vector<std::thread> threads;
+	for (int r = 0; r < readers; r++)
+		threads.push_back(std::thread([&, r] { read_loop(tree, keys, done, bad[writers + r]); }));
+	std::vector<std::thread> writing;
+	for (int w = 0; w < writers; w++)
+		writing.push_back(std::thread([&, w] { write_loop(tree, keys, w, bad[w]); }));
+	for (std::size_t i = 0; i < writing.size(); i++)
+		writing[i].join();
+	done = true;
+	for (std::size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	for (std::size_t i = 0; i < bad.size(); i++)
+		CHECK(bad[i] == 0);
+}
+
+static map_type expected(const std::vector<std::string>& keys)
+{
+	map_type map;
+	for (std::size_t i = 0; i < keys.size(); i++) {
+		if (i % (2 * writers) >= static_cast<std::size_t>(writers))
+			map[keys[i]] = keys[i];
+	}
+	return map;
+}
+
+// lookups of the settled tree against the map
+template<class Tree>
+static void check_contents(const Tree& tree, const map_type& map, const std::vector<std::string>& keys)
+{
+	CHECK(tree.size() == map.size());
+	CHECK(tree.empty() == map.empty());
+	for (std::size_t i = 0; i < keys.size(); i++) {
+		std::string value, match;
+		bool found = tree.find(keys[i], value);
+		CHECK(found == (map.count(keys[i]) != 0));
+		CHECK(!found || value == keys[i]);
+
+		std::string query = keys[i] + "ab";
+		std::string best;
+		bool any = false;
+		for (std::size_t len = 0; len <= query.size(); len++) {
+			if (map.count(query.substr(0, len))) {
+				best = query.substr(0, len);
+				any = true;
+			}
+		}
+		CHECK(tree.longest_match(query, match, value) == any);
+		CHECK(!any || (match == best && value == best));
+	}
+
+	const char* prefixes[] = { "", "a", "ab", "\x80", "abcd", "zz" };
+	for (std::size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++) {
+		std::vector<std::pair<const std::string, std::string> > vec;
+		tree.prefix_match(std::string(prefixes[p]), vec);
+		map_type::const_iterator m = map.lower_bound(prefixes[p]);
+		std::size_t j = 0;
+		for (; m != map.end() && starts_with(m->first, prefixes[p]); ++m, ++j)
+			CHECK(j < vec.size() && vec[j].first == m->first && vec[j].second == m->second);
+		CHECK(j == vec.size());
+	}
+}
+
+static void test_concurrent()
+{
+	std::vector<std::string> keys = make_keys(20000);
+	concurrent_radix_tree<std::string, std::string> tree;
+	run_threads(tree, keys);
+
+	map_type map = expected(keys);
+	check_contents(tree, map, keys);
+
+	// an existing key is not replaced, a missing one is not erased
+	CHECK(!tree.insert(*map.begin()));
+	CHECK(!tree.erase(std::string("zz")));
+	CHECK(tree.erase(map.begin()->first));
+	std::string value;
+	CHECK(!tree.find(map.begin()->first, value));
+	CHECK(tree.size() == map.size() - 1);
+}
+
+// a value whose copy can be made to fail, as the allocation of a node would
+struct fragile {
+	static bool fail;
+	int id;
+	explicit fragile(int i = 0) :id(i) { }
+	fragile(const fragile& other) :id(other.id)
+	{
+		if (fail)
+			throw std::bad_alloc();
+	}
+	fragile& operator=(const fragile& other) { id = other.id; return *this; }
+};
+
+bool fragile::fail = false;
+
+// an insert that throws leaves no node locked and nothing half linked
+static void test_throwing_insert()
+{
+	concurrent_radix_tree<std::string, fragile> tree;
+	const char* keys[] = { "abcd", "abxx", "q" };
+	for (std::size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+		CHECK(tree.insert(std::make_pair(std::string(keys[i]), fragile(static_cast<int>(i)))));
+
+	// a new leaf, a split at the end of the key and inside the key, and a value for an inner node
+	const char* failing[] = { "r", "abc", "abcz", "ab" };
+	std::vector<std::pair<const std::string, fragile> > vals;
+	for (std::size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++)
+		vals.push_back(std::make_pair(std::string(failing[i]), fragile()));
+	fragile::fail = true;
+	for (std::size_t i = 0; i < vals.size(); i++) {
+		bool thrown = false;
+		try {
+			tree.insert(vals[i]);
+		}
+		catch (const std::bad_alloc&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+	fragile::fail = false;
+
+	CHECK(tree.size() == 3);
+	fragile value;
+	for (std::size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+		CHECK(!tree.find(std::string(failing[i]), value));
+		CHECK(tree.insert(std::make_pair(std::string(failing[i]), fragile(10))));
+	}
+	CHECK(tree.erase(std::string("abxx")) && tree.erase(std::string("abc")));
+	CHECK(tree.find(std::string("abcd"), value) && value.id == 0);
+	CHECK(tree.size() == 5);
+}
+
+static void test_sharded(std::size_t shards, int prefix_bytes, radix_shard_function function)
+{
+	std::vector<std::string> keys = make_keys(20000);
+	sharded_radix_tree<std::string, std::string> tree(shards, prefix_bytes, function);
+	CHECK(tree.shards() == (shards == 0 ? 1 : shards));
+	run_threads(tree, keys);
+
+	map_type map = expected(keys);
+	check_contents(tree, map, keys);
+
+	// for_each merges the shards in key order and stops when visit returns false
+	std::vector<std::string> seen;
+	tree.for_each([&seen](const std::pair<const std::string, std::string>& val) { seen.push_back(val.first); return true; });
+	map_type::const_iterator m = map.begin();
+	CHECK(seen.size() == map.size());
+	for (std::size_t i = 0; i < seen.size() && m != map.end(); i++, ++m)
+		CHECK(seen[i] == m->first);
+	std::size_t visits = 0;
+	tree.for_each([&visits](const std::pair<const std::string, std::string>&) { visits++; return false; });
+	CHECK(visits == 1);
+
+	tree.clear();
+	CHECK(tree.empty() && tree.size() == 0);
+}
+
+int main()
+{
+	test_concurrent();
+	test_throwing_insert();
+	test_sharded(16, 1, radix_shard_by_byte);
+	test_sharded(7, 2, radix_shard_by_hash);
+	test_sharded(0, 1, radix_shard_by_byte);
+	return test_exit("test_concurrent");
+}
@@ -0,0 +1,175 @@
+// Checks frozen_radix_tree against the radix_tree it was frozen from and
+// std::map, for every public member, and radix_bit_vector's rank, select and
+// next against counting bit by bit.
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radix_tree_frozen.hpp"
+#include "test_check.hpp"
+
+typedef frozen_radix_tree<std::string, std::string> frozen_type;
+typedef std::map<std::string, std::string> map_type;
+
+static std::mt19937 rng(31337);
+
+static std::string random_key()
+{
+	std::string key;
+	int len = rng() % 8 == 0 ? 16 + rng() % 40 : rng() % 7;
+	for (int i = 0; i < len; i++)
+		key += "pqr\x00\xee"[rng() % 5];
+	return key;
+}
+
+static bool starts_with(const std::string& key, const std::string& prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+static void check_frozen(const frozen_type& frozen, const map_type& map)
+{
+	CHECK(frozen.size() == map.size() && frozen.empty() == map.empty());
+	CHECK(frozen.bytes() > 0);
+
+	// every element in key order, stopping when visit returns false
+	map_type::const_iterator m = map.begin();
+	bool ordered = true;
+	std::size_t n = frozen.for_each([&](const std::pair<const std::string, std::string>& val) {
+		ordered = ordered && m != map.end() && val == *m;
+		if (m != map.end())
+			++m;
+		return true;
+	});
+	CHECK(ordered && m == map.end() && n == map.size());
+	CHECK(frozen.for_each([](const std::pair<const std::string, std::string>&) { return false; }) == (map.empty() ? 0u : 1u));
+
+	for (m = map.begin(); m != map.end(); ++m) {
+		const std::string* v = frozen.find(m->first);
+		CHECK(v != NULL && *v == m->second);
+	}
+
+	for (int q = 0; q < 3000; q++) {
+		std::string key = random_key();
+		const char* data = key.data();
+		int len = static_cast<int>(key.size());
+
+		m = map.find(key);
+		const std::string* v = frozen.find(key);
+		CHECK((v == NULL) == (m == map.end()));
+		CHECK(frozen.find(data, len) == v);
+
+		map_type::const_iterator best = map.end();
+		for (std::size_t l = 0; l <= key.size(); l++) {
+			map_type::const_iterator b = map.find(key.substr(0, l));
+			if (b != map.end())
+				best = b;
+		}
+		std::string match = "unchanged";
+		v = frozen.longest_match(key, match);
+		CHECK((v == NULL) == (best == map.end()));
+		CHECK(v == NULL || best == map.end() || (match == best->first && *v == best->second));
+		CHECK(v != NULL || match == "unchanged");
+		int match_len = -1;
+		CHECK(frozen.longest_match(data, len, match_len) == v);
+		CHECK(v == NULL || match_len == static_cast<int>(match.size()));
+
+		std::vector<std::pair<const std::string, std::string> > expect, vec;
+		for (map_type::const_iterator p = map.lower_bound(key); p != map.end() && starts_with(p->first, key); ++p)
+			expect.push_back(*p);
+		frozen.prefix_match(key, vec);
+		CHECK(vec == expect);
+		frozen.prefix_match(data, len, vec, 2);
+		CHECK(vec.size() == std::min<std::size_t>(2, expect.size()));
+		frozen.prefix_match(key, vec, 0);
+		CHECK(vec.empty());
+		CHECK(frozen.for_each_prefix_match(data, len, [](const std::pair<const std::string, std::string>&) { return true; }) == expect.size());
+	}
+}
+
+static void test_frozen()
+{
+	radix_tree<std::string, std::string> tree;
+	map_type map;
+	for (int i = 0; i < 5000; i++) {
+		std::string key = random_key();
+		std::string value = std::to_string(i);
+		tree.insert(std::make_pair(key, value));
+		map.insert(std::make_pair(key, value));
+	}
+
+	frozen_type frozen(tree);
+	check_frozen(frozen, map);
+
+	// freezing again replaces the contents, the source tree may go away
+	frozen_type other;
+	check_frozen(other, map_type());
+	{
+		radix_tree<std::string, std::string> small;
+		small[std::string()] = "root";
+		small["pq"] = "pq";
+		other.freeze(small);
+	}
+	map_type small_map;
+	small_map[std::string()] = "root";
+	small_map["pq"] = "pq";
+	check_frozen(other, small_map);
+	other.freeze(tree);
+	check_frozen(other, map);
+	other.freeze(radix_tree<std::string, std::string>());
+	check_frozen(other, map_type());
+}
+
+static void test_bit_vector()
+{
+	for (std::size_t size = 0; size < 3000; size += 1 + size / 3) {
+		radix_bit_vector bits;
+		std::vector<bool> plain;
+		// long runs of either bit, and stretches of noise
+		for (std::size_t i = 0; i < size; i++) {
+			bool bit = (i / 700) % 3 == 0 ? true : (i / 700) % 3 == 1 ? false : (rng() & 1) != 0;
+			bits.push_back(bit);
+			plain.push_back(bit);
+		}
+		bits.build();
+		CHECK(bits.size() == size);
+		CHECK(bits.bytes() >= size / 8);
+
+		std::size_t ones = 0;
+		std::vector<std::size_t> one_at, zero_at;
+		for (std::size_t i = 0; i <= size; i++) {
+			CHECK(bits.rank1(i) == ones && bits.rank0(i) == i - ones);
+			if (i == size)
+				break;
+			CHECK(bits[i] == plain[i]);
+			if (plain[i]) {
+				one_at.push_back(i);
+				ones++;
+			}
+			else
+				zero_at.push_back(i);
+		}
+		for (std::size_t k = 0; k < one_at.size(); k++)
+			CHECK(bits.select1(k) == one_at[k]);
+		for (std::size_t k = 0; k < zero_at.size(); k++)
+			CHECK(bits.select0(k) == zero_at[k]);
+
+		std::size_t next1 = size, next0 = size;
+		for (std::size_t i = size; i-- > 0; ) {
+			if (plain[i])
+				next1 = i;
+			else
+				next0 = i;
+			CHECK(bits.next1(i) == next1 && bits.next0(i) == next0);
+		}
+	}
+}
+
+int main()
+{
+	test_frozen();
+	test_bit_vector();
+	return test_exit("test_frozen");
+}
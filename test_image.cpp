@@ -0,0 +1,192 @@
+// Checks the image round trip: radix_tree_write_image and radix_tree_save write a
+// tree, and radix_tree_view, attached to the bytes or mapping the file, must
+// answer every lookup as the tree does. Also checks the images a view refuses.
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radix_tree_image.hpp"
+#include "test_check.hpp"
+
+// a value wider than the key offsets and with stricter alignment than 8
+struct alignas(16) wide_value {
+	double weight;
+	int id;
+	bool operator==(const wide_value& rhs) const { return weight == rhs.weight && id == rhs.id; }
+};
+
+static std::mt19937 rng(2024);
+
+static std::string random_key()
+{
+	std::string key;
+	int len = rng() % 8 == 0 ? 16 + rng() % 30 : rng() % 7;
+	for (int i = 0; i < len; i++)
+		key += "mno\x01\xf0"[rng() % 5];
+	return key;
+}
+
+static bool starts_with(const std::string& key, const std::string& prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+template<class Value>
+static void check_view(const radix_tree_view<Value>& view, const std::map<std::string, Value>& map)
+{
+	typedef typename radix_tree_view<Value>::const_iterator const_iterator;
+	typedef typename std::map<std::string, Value>::const_iterator map_iterator;
+
+	CHECK(view.is_open());
+	CHECK(view.size() == map.size() && view.empty() == map.empty());
+
+	// records in key order, both ways
+	const_iterator it = view.begin();
+	for (map_iterator m = map.begin(); m != map.end(); ++m, ++it) {
+		CHECK(it != view.end());
+		CHECK(std::string((*it).key(), it->key_length()) == m->first && it->value() == m->second);
+	}
+	CHECK(it == view.end());
+	for (typename std::map<std::string, Value>::const_reverse_iterator m = map.rbegin(); m != map.rend(); ++m) {
+		const_iterator prev = it--;
+		CHECK(prev != it && std::string(it->key(), it->key_length()) == m->first);
+	}
+	CHECK(it == view.begin());
+
+	for (int q = 0; q < 3000; q++) {
+		std::string key = random_key();
+		const char* data = key.data();
+		int len = static_cast<int>(key.size());
+
+		map_iterator m = map.find(key);
+		it = view.find(data, len);
+		CHECK((it == view.end()) == (m == map.end()));
+		CHECK(it == view.end() || m == map.end() || (std::string(it->key(), it->key_length()) == key && it->value() == m->second));
+		CHECK(view.find(std::string_view(key)) == it);
+
+		map_iterator best = map.end();
+		for (std::size_t l = 0; l <= key.size(); l++) {
+			map_iterator b = map.find(key.substr(0, l));
+			if (b != map.end())
+				best = b;
+		}
+		it = view.longest_match(data, len);
+		CHECK((it == view.end()) == (best == map.end()));
+		CHECK(it == view.end() || best == map.end() || std::string(it->key(), it->key_length()) == best->first);
+		CHECK(view.longest_match(std::string_view(key)) == it);
+
+		std::vector<std::string> expect;
+		for (map_iterator p = map.lower_bound(key); p != map.end() && starts_with(p->first, key); ++p)
+			expect.push_back(p->first);
+		std::vector<std::string> got;
+		typename radix_tree_view<Value>::range r = view.prefix_range(data, len);
+		for (const_iterator p = r.begin(); p != r.end(); ++p)
+			got.push_back(std::string(p->key(), p->key_length()));
+		CHECK(got == expect);
+		r = view.prefix_range(std::string_view(key));
+		CHECK(static_cast<std::size_t>(std::distance(r.begin(), r.end())) == expect.size());
+
+		std::vector<const_iterator> vec;
+		view.prefix_match(data, len, vec);
+		CHECK(vec.size() == expect.size());
+		for (std::size_t i = 0; i < vec.size() && i < expect.size(); i++)
+			CHECK(std::string(vec[i]->key(), vec[i]->key_length()) == expect[i]);
+		view.prefix_match(std::string_view(key), vec, 1);
+		CHECK(vec.size() == (expect.empty() ? 0u : 1u));
+	}
+}
+
+static void test_round_trip()
+{
+	radix_tree<std::string, wide_value> tree;
+	std::map<std::string, wide_value> map;
+	for (int i = 0; i < 5000; i++) {
+		std::string key = random_key();
+		wide_value v = { i * 0.5, i };
+		tree.insert(std::make_pair(key, v));
+		map.insert(std::make_pair(key, v));
+	}
+
+	std::vector<char> image;
+	CHECK(radix_tree_write_image(tree, image));
+	CHECK(!image.empty());
+
+	radix_tree_view<wide_value> view;
+	CHECK(!view.is_open() && view.empty() && view.begin() == view.end());
+	CHECK(view.attach(image.data(), image.size()));
+	check_view(view, map);
+
+	// the image is position independent: a copy elsewhere reads the same
+	std::vector<char> copy(image);
+	image.assign(image.size(), 0);
+	CHECK(view.attach(copy.data(), copy.size()));
+	check_view(view, map);
+	view.close();
+	CHECK(!view.is_open() && view.size() == 0);
+
+	const char* path = "test_image.tmp";
+	CHECK(radix_tree_save(tree, path));
+	CHECK(view.open(path));
+	check_view(view, map);
+	// reopening drops the old mapping first
+	CHECK(view.open(path));
+	CHECK(view.size() == map.size());
+	view.close();
+	std::remove(path);
+
+	CHECK(!view.open("no such directory/test_image.tmp"));
+	CHECK(!radix_tree_save(tree, "no such directory/test_image.tmp"));
+	CHECK(!view.is_open());
+}
+
+static void test_small_trees()
+{
+	// an empty tree and one holding only the empty key
+	radix_tree<std::string, int> tree;
+	std::map<std::string, int> map;
+	std::vector<char> image;
+	radix_tree_view<int> view;
+
+	CHECK(radix_tree_write_image(tree, image));
+	CHECK(view.attach(image.data(), image.size()));
+	check_view(view, map);
+
+	tree[std::string()] = 5;
+	map[std::string()] = 5;
+	CHECK(radix_tree_write_image(tree, image));
+	CHECK(view.attach(image.data(), image.size()));
+	check_view(view, map);
+	view.close();
+}
+
+static void test_rejected()
+{
+	radix_tree<std::string, int> tree;
+	for (int i = 0; i < 100; i++)
+		tree[random_key()] = i;
+	std::vector<char> image;
+	CHECK(radix_tree_write_image(tree, image));
+
+	// a view for another value type, a truncated image and a foreign magic
+	radix_tree_view<wide_value> wide;
+	CHECK(!wide.attach(image.data(), image.size()));
+	radix_tree_view<int> view;
+	CHECK(!view.attach(image.data(), sizeof(radix_tree_image_header) - 1));
+	CHECK(!view.attach(image.data(), image.size() - 1));
+	std::vector<char> bad(image);
+	bad[0] ^= 1;
+	CHECK(!view.attach(bad.data(), bad.size()));
+	CHECK(!view.is_open());
+	CHECK(view.attach(image.data(), image.size()));
+	CHECK(view.size() == tree.size());
+}
+
+int main()
+{
+	test_round_trip();
+	test_small_trees();
+	test_rejected();
+	return test_exit("test_image");
+}
@@ -0,0 +1,233 @@
+// Checks persistent_radix_tree: every public member against std::map, and that
+// each snapshot keeps answering as the map did when it was taken, while the tree
+// goes on changing, in this thread and with readers on other threads.
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "radix_tree_persistent.hpp"
+#include "test_check.hpp"
+
+typedef persistent_radix_tree<std::string, int> tree_type;
+typedef std::map<std::string, int> map_type;
+
+static std::mt19937 rng(99);
+
+static std::string random_key()
+{
+	std::string key;
+	int len = rng() % 8 == 0 ? 16 + rng() % 20 : rng() % 6;
+	for (int i = 0; i < len; i++)
+		key += "xyz\xfe"[rng() % 4];
+	return key;
+}
+
+static bool starts_with(const std::string& key, const std::string& prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+// a version against the map it should equal
+static bool same(const tree_type::version& v, const map_type& map)
+{
+	if (v.size() != map.size() || v.empty() != map.empty())
+		return false;
+
+	map_type::const_iterator m = map.begin();
+	bool ok = true;
+	v.for_each([&](const std::pair<const std::string, int>& val) {
+		ok = ok && m != map.end() && val == *m;
+		if (m != map.end())
+			++m;
+		return true;
+	});
+	if (!ok || m != map.end())
+		return false;
+
+	for (m = map.begin(); m != map.end(); ++m) {
+		const std::pair<const std::string, int>* p = v.find(m->first);
+		if (p == NULL || *p != *m || v.find(m->first.data(), static_cast<int>(m->first.size())) != p)
+			return false;
+	}
+	return true;
+}
+
+static void check_lookups(const tree_type::version& v, const map_type& map, const std::string& key)
+{
+	const std::pair<const std::string, int>* p = v.find(key);
+	CHECK((p == NULL) == (map.count(key) == 0));
+
+	map_type::const_iterator best = map.end();
+	for (std::size_t len = 0; len <= key.size(); len++) {
+		map_type::const_iterator b = map.find(key.substr(0, len));
+		if (b != map.end())
+			best = b;
+	}
+	p = v.longest_match(key);
+	CHECK((p == NULL) == (best == map.end()));
+	CHECK(p == NULL || best == map.end() || *p == *best);
+	CHECK(v.longest_match(key.data(), static_cast<int>(key.size())) == p);
+
+	std::vector<const std::pair<const std::string, int>*> vec, raw;
+	v.prefix_match(key, vec);
+	v.prefix_match(key.data(), static_cast<int>(key.size()), raw);
+	CHECK(vec == raw);
+	std::size_t i = 0;
+	for (map_type::const_iterator m = map.lower_bound(key); m != map.end() && starts_with(m->first, key); ++m, i++)
+		CHECK(i < vec.size() && *vec[i] == *m);
+	CHECK(i == vec.size());
+}
+
+// the tree answers from its current version, with the very same elements
+static bool same(const tree_type& tree, const map_type& map)
+{
+	tree_type::version v = tree.snapshot();
+	if (tree.size() != v.size() || tree.empty() != v.empty() || !same(v, map))
+		return false;
+
+	map_type::const_iterator m = map.begin();
+	bool ok = true;
+	tree.for_each([&](const std::pair<const std::string, int>& val) {
+		ok = ok && m != map.end() && &val == v.find(m->first);
+		if (m != map.end())
+			++m;
+		return true;
+	});
+	return ok && m == map.end();
+}
+
+static void check_lookups(const tree_type& tree, const map_type& map, const std::string& key)
+{
+	tree_type::version v = tree.snapshot();
+	check_lookups(v, map, key);
+	CHECK(tree.find(key) == v.find(key));
+	CHECK(tree.longest_match(key) == v.longest_match(key));
+	std::vector<const std::pair<const std::string, int>*> vec, current;
+	v.prefix_match(key, vec);
+	tree.prefix_match(key, current);
+	CHECK(vec == current);
+}
+
+static void test_versions()
+{
+	tree_type tree;
+	map_type map;
+	std::vector<std::pair<tree_type::version, map_type> > kept;
+
+	CHECK(tree.empty() && tree.size() == 0 && tree.find("x") == NULL);
+	kept.push_back(std::make_pair(tree.snapshot(), map));
+
+	for (int op = 0; op < 6000; op++) {
+		std::string key = random_key();
+		switch (rng() % 4) {
+		case 0:
+		case 1: {
+			int value = static_cast<int>(rng() % 100);
+			// an existing key keeps its value
+			CHECK(tree.insert(std::make_pair(key, value)) == map.insert(std::make_pair(key, value)).second);
+			break;
+		}
+		case 2:
+			CHECK(tree.erase(key) == (map.erase(key) != 0));
+			break;
+		default:
+			CHECK(tree.erase(key.data(), static_cast<int>(key.size())) == (map.erase(key) != 0));
+			break;
+		}
+		check_lookups(tree, map, random_key());
+		if (op % 300 == 0)
+			kept.push_back(std::make_pair(tree.snapshot(), map));
+	}
+	CHECK(same(tree, map));
+
+	// old versions are untouched by everything that happened since
+	for (std::size_t i = 0; i < kept.size(); i++) {
+		CHECK(same(kept[i].first, kept[i].second));
+		check_lookups(kept[i].first, kept[i].second, random_key());
+	}
+
+	// versions copy and assign like values, a default one is empty
+	tree_type::version empty_version;
+	CHECK(empty_version.empty() && empty_version.size() == 0 && empty_version.find("") == NULL);
+	tree_type::version copy(kept[3].first);
+	CHECK(same(copy, kept[3].second));
+	copy = kept[5].first;
+	CHECK(same(copy, kept[5].second));
+	tree_type::version& self = copy;
+	copy = self;
+	CHECK(same(copy, kept[5].second));
+	kept[5].first = empty_version;
+	CHECK(same(copy, kept[5].second));
+
+	// stopping early
+	int visits = 0;
+	tree.for_each([&visits](const std::pair<const std::string, int>&) { visits++; return false; });
+	CHECK(visits == (map.empty() ? 0 : 1));
+
+	// copies of the tree share nodes and diverge with the next update
+	tree_type other(tree);
+	CHECK(same(other, map));
+	map_type other_map = map;
+	other.insert(std::make_pair(std::string("only in other"), 1));
+	other_map.insert(std::make_pair(std::string("only in other"), 1));
+	tree.erase(map.begin()->first);
+	map.erase(map.begin());
+	CHECK(same(tree, map));
+	CHECK(same(other, other_map));
+	tree_type assigned;
+	assigned = other;
+	CHECK(same(assigned, other_map));
+
+	tree_type::version before_clear = tree.snapshot();
+	tree.clear();
+	CHECK(tree.empty() && same(tree, map_type()));
+	CHECK(same(before_clear, map));
+	tree.insert(std::make_pair(std::string(), 7));
+	CHECK(tree.find("") != NULL && tree.find("")->second == 7 && tree.longest_match("abc") == tree.find(""));
+}
+
+// readers check their own snapshots while one writer keeps replacing the tree
+static void test_threads()
+{
+	tree_type tree;
+	map_type map;
+	for (int i = 0; i < 2000; i++) {
+		std::string key = random_key();
+		tree.insert(std::make_pair(key, i));
+		map.insert(std::make_pair(key, i));
+	}
+	tree_type::version start = tree.snapshot();
+
+	std::vector<int> bad(3);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 3; r++) {
+		readers.push_back(std::thread([&, r] {
+			tree_type::version v = start;
+			for (int round = 0; round < 20; round++) {
+				if (!same(v, map))
+					bad[r]++;
+			}
+		}));
+	}
+	for (int i = 0; i < 20000; i++) {
+		std::string key = random_key();
+		if (i % 2)
+			tree.insert(std::make_pair(key, -i));
+		else
+			tree.erase(key);
+	}
+	for (std::size_t r = 0; r < readers.size(); r++)
+		readers[r].join();
+	for (std::size_t r = 0; r < bad.size(); r++)
+		CHECK(bad[r] == 0);
+	CHECK(same(start, map));
+}
+
+int main()
+{
+	test_versions();
+	test_threads();
+	return test_exit("test_persistent");
+}
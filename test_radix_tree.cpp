@@ -0,0 +1,587 @@
+// Checks radix_tree against std::map under random operations, comparing every
+// lookup and the full contents as the tree changes.
+// The bulk operations are checked against brute force over the same keys.
+// CMake builds it three times: as is, with RADIX_TREE_SUBTREE_COUNTS and with
+// RADIX_TREE_COUNTERS.
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radix_tree.hpp"
+#include "radix_tree_reclaimer.hpp"
+#include "test_check.hpp"
+
+typedef radix_tree<std::string, int> tree_type;
+typedef std::map<std::string, int> map_type;
+
+static std::mt19937 rng(12345);
+
+// keys over a small alphabet so that they share prefixes, and a few long ones
+static std::string random_key()
+{
+	static const char alphabet[] = "abc\xff";
+	std::string key;
+	int len = rng() % 8 == 0 ? 16 + rng() % 24 : rng() % 7;
+	for (int i = 0; i < len; i++)
+		key += alphabet[rng() % 4];
+	return key;
+}
+
+static std::vector<std::string> random_keys(std::size_t n)
+{
+	std::vector<std::string> keys;
+	for (std::size_t i = 0; i < n; i++)
+		keys.push_back(random_key());
+	return keys;
+}
+
+static bool starts_with(const std::string& key, const std::string& prefix)
+{
+	return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+// keys compare as unsigned bytes, as std::string does
+static bool same(tree_type& tree, const map_type& map)
+{
+	if (tree.size() != map.size() || tree.empty() != map.empty())
+		return false;
+	if (!std::equal(map.begin(), map.end(), tree.begin(), tree.end()))
+		return false;
+	if (!std::equal(map.rbegin(), map.rend(), tree.rbegin(), tree.rend()))
+		return false;
+	const tree_type& c = tree;
+	return std::equal(map.begin(), map.end(), c.cbegin(), c.cend());
+}
+
+static std::vector<std::string> keys_of(tree_type::range r)
+{
+	std::vector<std::string> keys;
+	for (tree_type::iterator it = r.begin(); it != r.end(); ++it)
+		keys.push_back(it->first);
+	return keys;
+}
+
+static std::vector<std::string> keys_of(const std::vector<tree_type::iterator>& vec)
+{
+	std::vector<std::string> keys;
+	for (std::size_t i = 0; i < vec.size(); i++)
+		keys.push_back(vec[i]->first);
+	return keys;
+}
+
+static std::vector<std::string> keys_of(const map_type& map, const std::string& prefix)
+{
+	std::vector<std::string> keys;
+	for (map_type::const_iterator it = map.lower_bound(prefix); it != map.end() && starts_with(it->first, prefix); ++it)
+		keys.push_back(it->first);
+	return keys;
+}
+
+// Levenshtein distance of a and b; with prefix, the smallest over the prefixes of a
+static int edit_distance(const std::string& a, const std::string& b, bool prefix = false)
+{
+	std::vector<int> row(b.size() + 1);
+	for (std::size_t j = 0; j <= b.size(); j++)
+		row[j] = static_cast<int>(j);
+	int best = row[b.size()];
+	for (std::size_t i = 1; i <= a.size(); i++) {
+		int diagonal = row[0];
+		row[0] = static_cast<int>(i);
+		for (std::size_t j = 1; j <= b.size(); j++) {
+			int up = row[j];
+			row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1), diagonal + (a[i - 1] != b[j - 1]));
+			diagonal = up;
+		}
+		best = std::min(best, row[b.size()]);
+	}
+	return prefix ? best : row[b.size()];
+}
+
+static void check_lookups(tree_type& tree, const map_type& map, const std::string& key)
+{
+	tree_type::iterator it = tree.find(key);
+	map_type::const_iterator m = map.find(key);
+	CHECK((it == tree.end()) == (m == map.end()));
+	if (it != tree.end() && m != map.end())
+		CHECK(it->second == m->second);
+	CHECK(tree.find(key.data(), static_cast<int>(key.size())) == it);
+	const tree_type& c = tree;
+	CHECK(c.find(key) == tree_type::const_iterator(it));
+
+	// the longest stored key that key starts with
+	map_type::const_iterator best = map.end();
+	for (std::size_t len = 0; len <= key.size(); len++) {
+		map_type::const_iterator p = map.find(key.substr(0, len));
+		if (p != map.end())
+			best = p;
+	}
+	it = tree.longest_match(key);
+	CHECK((it == tree.end()) == (best == map.end()));
+	if (it != tree.end() && best != map.end())
+		CHECK(it->first == best->first);
+
+	map_type::const_iterator lo = map.lower_bound(key), hi = map.upper_bound(key);
+	it = tree.lower_bound(key);
+	CHECK(lo == map.end() ? it == tree.end() : it != tree.end() && it->first == lo->first);
+	it = tree.upper_bound(key);
+	CHECK(hi == map.end() ? it == tree.end() : it != tree.end() && it->first == hi->first);
+	CHECK(c.lower_bound(key) == tree_type::const_iterator(tree.lower_bound(key)));
+	CHECK(c.upper_bound(key) == tree_type::const_iterator(tree.upper_bound(key)));
+	CHECK(keys_of(tree.equal_range(key)) == std::vector<std::string>(m != map.end() ? 1 : 0, key));
+
+	std::vector<std::string> expect = keys_of(map, key);
+	std::vector<tree_type::iterator> vec;
+	tree.prefix_match(key, vec);
+	CHECK(keys_of(vec) == expect);
+	CHECK(keys_of(tree.prefix_range(key)) == expect);
+	tree.prefix_match(key, vec, 2);
+	CHECK(vec.size() == std::min<std::size_t>(2, expect.size()));
+	std::size_t visited = tree.for_each_prefix_match(key, [](tree_type::iterator) { return true; });
+	CHECK(visited == expect.size());
+
+	// greedy matching widens a failed prefix match to the subtree the key leads into
+	tree.greedy_match(key, vec);
+	std::vector<std::string> greedy = keys_of(vec);
+	CHECK(std::includes(greedy.begin(), greedy.end(), expect.begin(), expect.end()));
+	CHECK(std::is_sorted(greedy.begin(), greedy.end()));
+	CHECK(tree.empty() || !greedy.empty());
+	CHECK(keys_of(tree.greedy_range(key)) == greedy);
+	CHECK(tree.for_each_greedy_match(key, [](tree_type::iterator) { return false; }) == (greedy.empty() ? 0u : 1u));
+
+	CHECK(tree.count_prefix(key) == expect.size());
+	CHECK(tree.rank(key) == static_cast<std::size_t>(std::distance(map.begin(), lo)));
+}
+
+static void test_random_operations()
+{
+	tree_type tree;
+	map_type map;
+
+	for (int op = 0; op < 20000; op++) {
+		std::string key = random_key();
+		int value = static_cast<int>(rng() % 1000);
+		switch (rng() % 8) {
+		case 0: {
+			std::pair<tree_type::iterator, bool> r = tree.insert(tree_type::value_type(key, value));
+			std::pair<map_type::iterator, bool> m = map.insert(map_type::value_type(key, value));
+			CHECK(r.second == m.second && r.first->second == m.first->second);
+			break;
+		}
+		case 1:
+			tree[key] = value;
+			map[key] = value;
+			break;
+		case 2: {
+			std::pair<tree_type::iterator, bool> r = tree.insert_or_assign(key, value);
+			CHECK(r.second == (map.find(key) == map.end()));
+			map[key] = value;
+			break;
+		}
+		case 3: {
+			std::pair<tree_type::iterator, bool> r = rng() % 2 ? tree.try_emplace(key, value) : tree.emplace(key, value);
+			CHECK(r.second == map.emplace(key, value).second);
+			break;
+		}
+		case 4:
+		case 5:
+			CHECK(tree.erase(key) == (map.erase(key) != 0));
+			break;
+		case 6: {
+			tree_type::iterator it = tree.find(key);
+			if (it != tree.end()) {
+				tree.erase(it);
+				map.erase(key);
+			}
+			break;
+		}
+		default:
+			check_lookups(tree, map, key);
+			break;
+		}
+		if (op % 500 == 0)
+			CHECK(same(tree, map));
+	}
+	CHECK(same(tree, map));
+
+	// nth walks to the ith key in order, rank is its position
+	std::size_t i = 0;
+	for (map_type::const_iterator m = map.begin(); m != map.end(); ++m, i++) {
+		tree_type::iterator it = tree.nth(i);
+		CHECK(it != tree.end() && it->first == m->first);
+		CHECK(tree.rank(m->first) == i);
+	}
+	CHECK(tree.nth(map.size()) == tree.end());
+	const tree_type& c = tree;
+	CHECK(c.nth(0) == c.begin());
+
+	// lo >= hi gives an empty range
+	CHECK(keys_of(tree.bound_range("b", "a")).empty());
+	std::vector<std::string> expect;
+	for (map_type::const_iterator m = map.lower_bound("ab"); m != map.end() && m->first < "c"; ++m)
+		expect.push_back(m->first);
+	CHECK(keys_of(tree.bound_range("ab", "c")) == expect);
+	CHECK(tree.for_each_in_range("ab", "c", [](tree_type::iterator) { return true; }) == expect.size());
+
+	radix_tree_stats st = tree.stats();
+	CHECK(st.values == map.size());
+	CHECK(st.nodes >= st.values);
+
+	tree.clear();
+	CHECK(tree.empty() && tree.begin() == tree.end());
+	tree["again"] = 1;
+	CHECK(tree.size() == 1 && tree.find("again") != tree.end());
+
+	// the comparator object is accepted and, the order being bytewise, not needed
+	tree_type compared((std::less<std::string>()));
+	compared["b"] = 2;
+	compared["a"] = 1;
+	CHECK(compared.size() == 2 && compared.begin()->first == "a");
+}
+
+// a move-only mapped type compiles only if the move-aware members never copy it
+static void test_move_only()
+{
+	typedef radix_tree<std::string, std::unique_ptr<int> > ptr_tree;
+	ptr_tree tree;
+
+	std::pair<ptr_tree::iterator, bool> r = tree.insert(ptr_tree::value_type("a", std::unique_ptr<int>(new int(1))));
+	CHECK(r.second && *r.first->second == 1);
+	r = tree.emplace("b", std::unique_ptr<int>(new int(2)));
+	CHECK(r.second && *r.first->second == 2);
+
+	// try_emplace leaves its arguments alone when the key is already there
+	std::unique_ptr<int> p(new int(3));
+	r = tree.try_emplace("a", std::move(p));
+	CHECK(!r.second && *r.first->second == 1);
+	CHECK(p != NULL && *p == 3);
+	r = tree.try_emplace("c", std::move(p));
+	CHECK(r.second && *r.first->second == 3 && p == NULL);
+
+	// insert_or_assign moves the very object in, for a new key and over an existing one
+	std::unique_ptr<int> q(new int(4));
+	int* raw = q.get();
+	r = tree.insert_or_assign("a", std::move(q));
+	CHECK(!r.second && r.first->second.get() == raw && q == NULL);
+	q.reset(new int(5));
+	raw = q.get();
+	r = tree.insert_or_assign("d", std::move(q));
+	CHECK(r.second && r.first->second.get() == raw && q == NULL);
+
+	tree["e"].reset(new int(6));
+	const char* keys[] = { "a", "b", "c", "d", "e" };
+	const int values[] = { 4, 2, 3, 5, 6 };
+	std::size_t i = 0;
+	for (ptr_tree::iterator it = tree.begin(); it != tree.end(); ++it, i++)
+		CHECK(i < 5 && it->first == keys[i] && *it->second == values[i]);
+	CHECK(i == 5);
+	CHECK(tree.erase("b") && tree.size() == 4);
+}
+
+// a value whose copy can be made to fail for one id, as an allocation in a loading thread can
+struct throwing_copy {
+	static bool armed;
+	int id;
+	explicit throwing_copy(int i) :id(i) { }
+	throwing_copy(const throwing_copy& other) :id(other.id)
+	{
+		if (armed && id < 0)
+			throw std::bad_alloc();
+	}
+};
+
+bool throwing_copy::armed = false;
+
+static void test_bulk_load()
+{
+	std::vector<std::string> keys = random_keys(3000);
+	std::vector<std::pair<std::string, int> > sorted, unsorted;
+	map_type map;
+	for (std::size_t i = 0; i < keys.size(); i++) {
+		unsorted.push_back(std::make_pair(keys[i], static_cast<int>(i)));
+		map.insert(std::make_pair(keys[i], static_cast<int>(i)));
+	}
+	sorted.assign(map.begin(), map.end());
+
+	// a repeated key keeps its first value, like map::insert
+	tree_type a(unsorted.begin(), unsorted.end());
+	CHECK(same(a, map));
+	tree_type b;
+	b.bulk_load(sorted.begin(), sorted.end());
+	CHECK(same(b, map));
+	tree_type p;
+	p.bulk_load_parallel(sorted.begin(), sorted.end(), 4);
+	CHECK(same(p, map));
+	// loading into a tree that already holds keys inserts the rest one by one
+	b.bulk_load(unsorted.begin(), unsorted.end());
+	CHECK(same(b, map));
+
+	// from rvalues the elements are moved, rejected ones too, so a move-only value loads
+	typedef radix_tree<std::string, std::unique_ptr<int> > ptr_tree;
+	for (int parallel = 0; parallel < 2; parallel++) {
+		std::vector<std::pair<std::string, std::unique_ptr<int> > > owned;
+		for (std::size_t i = 0; i < unsorted.size(); i++)
+			owned.push_back(std::make_pair(unsorted[i].first, std::unique_ptr<int>(new int(unsorted[i].second))));
+		ptr_tree moved;
+		if (parallel)
+			moved.bulk_load_parallel(std::make_move_iterator(owned.begin()), std::make_move_iterator(owned.end()), 4);
+		else
+			moved.bulk_load(std::make_move_iterator(owned.begin()), std::make_move_iterator(owned.end()));
+		CHECK(moved.size() == map.size());
+		map_type::const_iterator m = map.begin();
+		for (ptr_tree::iterator it = moved.begin(); it != moved.end() && m != map.end(); ++it, ++m)
+			CHECK(it->first == m->first && *it->second == m->second);
+	}
+
+	// an exception in a loading thread reaches the caller, the tree keeps what was loaded
+	typedef radix_tree<std::string, throwing_copy> throwing_tree;
+	std::vector<std::pair<std::string, throwing_copy> > values;
+	for (std::size_t i = 0; i < sorted.size(); i++)
+		values.push_back(std::make_pair(sorted[i].first, throwing_copy(i == sorted.size() / 2 ? -1 : 0)));
+	throwing_tree partial;
+	bool thrown = false;
+	throwing_copy::armed = true;
+	try {
+		partial.bulk_load_parallel(values.begin(), values.end(), 4);
+	}
+	catch (const std::bad_alloc&) {
+		thrown = true;
+	}
+	throwing_copy::armed = false;
+	CHECK(thrown);
+	std::size_t loaded = 0;
+	for (throwing_tree::iterator it = partial.begin(); it != partial.end(); ++it, loaded++)
+		CHECK(map.count(it->first) != 0 && partial.find(it->first) == it);
+	CHECK(loaded == partial.size() && loaded < map.size());
+
+	std::vector<tree_type::iterator> found(keys.size()), longest(keys.size());
+	for (std::size_t i = 0; i < keys.size(); i++)
+		keys[i] += "x";
+	a.find_batch(keys.data(), keys.size(), found.data());
+	a.longest_match_batch(keys.data(), keys.size(), longest.data());
+	for (std::size_t i = 0; i < keys.size(); i++) {
+		CHECK(found[i] == a.find(keys[i]));
+		CHECK(longest[i] == a.longest_match(keys[i]));
+	}
+}
+
+static void fill(tree_type& tree, map_type& map, std::size_t n, int value)
+{
+	std::vector<std::string> keys = random_keys(n);
+	for (std::size_t i = 0; i < keys.size(); i++) {
+		tree.insert(tree_type::value_type(keys[i], value));
+		map.insert(map_type::value_type(keys[i], value));
+	}
+}
+
+static void test_merge(bool shared)
+{
+	radix_tree_pool pool;
+	tree_type own_a, own_b;
+	tree_type pooled_a(pool), pooled_b(pool);
+	tree_type& a = shared ? pooled_a : own_a;
+	tree_type& b = shared ? pooled_b : own_b;
+	map_type ma, mb;
+	fill(a, ma, 2000, 1);
+	fill(b, mb, 2000, 2);
+
+	std::size_t common = 0;
+	map_type expect = ma;
+	for (map_type::const_iterator m = mb.begin(); m != mb.end(); ++m)
+		if (!expect.insert(*m).second)
+			common++;
+	CHECK(a.merge(std::move(b)) == common);
+	CHECK(b.empty() && b.begin() == b.end());
+	CHECK(same(a, expect));
+
+	// the other tree's value wins with radix_merge_replace, a custom resolve sees both
+	tree_type c;
+	map_type mc;
+	fill(c, mc, 500, 3);
+	for (map_type::const_iterator m = mc.begin(); m != mc.end(); ++m)
+		expect[m->first] = 3;
+	a.merge(std::move(c), radix_merge_replace());
+	CHECK(same(a, expect));
+	tree_type d;
+	for (map_type::const_iterator m = expect.begin(); m != expect.end(); ++m)
+		d[m->first] = 10;
+	CHECK(a.merge(std::move(d), [](int& mine, int& theirs) { mine += theirs; }) == expect.size());
+	for (map_type::iterator m = expect.begin(); m != expect.end(); ++m)
+		m->second += 10;
+	CHECK(same(a, expect));
+}
+
+static void test_split(bool shared)
+{
+	radix_tree_pool pool;
+	tree_type own_a, own_out;
+	tree_type pooled_a(pool), pooled_out(pool);
+	tree_type& a = shared ? pooled_a : own_a;
+	tree_type& out = shared ? pooled_out : own_out;
+	map_type ma, mout;
+	fill(a, ma, 3000, 1);
+	fill(out, mout, 200, 2);
+
+	// keys starting with the prefix move, out keeps its own value for a key both hold
+	std::string prefix = "ab";
+	std::size_t moved = 0;
+	for (map_type::iterator m = ma.lower_bound(prefix); m != ma.end() && starts_with(m->first, prefix); ) {
+		mout.insert(*m);
+		m = ma.erase(m);
+		moved++;
+	}
+	CHECK(a.split(prefix, out) == moved);
+	CHECK(same(a, ma));
+	CHECK(same(out, mout));
+
+	// keys not less than the key move
+	tree_type own_rest, pooled_rest(pool);
+	tree_type& rest = shared ? pooled_rest : own_rest;
+	map_type mrest(ma.lower_bound("b"), ma.end());
+	ma.erase(ma.lower_bound("b"), ma.end());
+	CHECK(a.split_at("b", rest) == mrest.size());
+	CHECK(same(a, ma));
+	CHECK(same(rest, mrest));
+
+	// an empty prefix moves everything
+	tree_type own_all, pooled_all(pool);
+	tree_type& all = shared ? pooled_all : own_all;
+	CHECK(rest.split(std::string(), all) == mrest.size());
+	CHECK(rest.empty() && same(all, mrest));
+}
+
+static void test_erase_prefix_remove_if()
+{
+	tree_type tree;
+	map_type map;
+	fill(tree, map, 3000, 0);
+	for (map_type::iterator m = map.begin(); m != map.end(); ++m)
+		tree[m->first] = m->second = static_cast<int>(m->first.size());
+
+	const char* prefixes[] = { "ca", "\xff", "abcabc", "zzz", "a" };
+	for (std::size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++) {
+		std::string prefix = prefixes[p];
+		std::size_t n = 0;
+		for (map_type::iterator m = map.lower_bound(prefix); m != map.end() && starts_with(m->first, prefix); n++)
+			m = map.erase(m);
+		CHECK(tree.erase_prefix(prefix) == n);
+		CHECK(same(tree, map));
+	}
+
+	std::size_t removed = 0;
+	for (map_type::iterator m = map.begin(); m != map.end(); ) {
+		if (m->first.size() % 3 == 0) {
+			m = map.erase(m);
+			removed++;
+		}
+		else
+			++m;
+	}
+	CHECK(tree.remove_if([](const std::string& key) { return key.size() % 3 == 0; }) == removed);
+	CHECK(same(tree, map));
+
+	CHECK(tree.erase_prefix(std::string()) == map.size());
+	CHECK(tree.empty() && tree.begin() == tree.end());
+}
+
+static void test_fuzzy()
+{
+	tree_type tree;
+	map_type map;
+	fill(tree, map, 2000, 0);
+
+	for (int q = 0; q < 200; q++) {
+		std::string key = random_key();
+		int edits = static_cast<int>(rng() % 3);
+
+		std::vector<std::pair<std::string, int> > expect, got;
+		for (map_type::const_iterator m = map.begin(); m != map.end(); ++m) {
+			int d = edit_distance(m->first, key);
+			if (d <= edits)
+				expect.push_back(std::make_pair(m->first, d));
+		}
+		std::size_t n = tree.fuzzy_match(key, edits, [&](tree_type::iterator it, int d) {
+			got.push_back(std::make_pair(it->first, d));
+			return true;
+		});
+		CHECK(n == expect.size());
+		CHECK(got == expect);
+
+		// the distance of a key's closest prefix
+		expect.clear();
+		got.clear();
+		for (map_type::const_iterator m = map.begin(); m != map.end(); ++m) {
+			int d = edit_distance(m->first, key, true);
+			if (d <= edits)
+				expect.push_back(std::make_pair(m->first, d));
+		}
+		tree.fuzzy_prefix_match(key, edits, [&](tree_type::iterator it, int d) {
+			got.push_back(std::make_pair(it->first, d));
+			return true;
+		});
+		CHECK(got == expect);
+
+		// visit returning false stops at the first match
+		CHECK(tree.fuzzy_prefix_match(key, edits, [](tree_type::iterator, int) { return false; }) == (expect.empty() ? 0u : 1u));
+	}
+	CHECK(tree.fuzzy_match("abc", -1, [](tree_type::iterator, int) { return true; }) == 0);
+}
+
+static void test_counters()
+{
+	tree_type tree;
+	tree["abc"] = 1;
+	tree["abd"] = 2;
+	tree.reset_counters();
+	tree.find("abc");
+	tree.erase("abd");
+	radix_tree_counters c = tree.counters();
+#ifdef RADIX_TREE_COUNTERS
+	CHECK(c.lookups >= 1 && c.levels >= 1);
+	CHECK(c.erases == 1 && c.merges == 1);
+	tree["abd"] = 2;
+	CHECK(tree.counters().inserts == 1 && tree.counters().splits == 1);
+#else
+	CHECK(c.lookups == 0 && c.erases == 0);
+#endif
+	tree.reset_counters();
+	CHECK(tree.counters().lookups == 0);
+}
+
+static void test_reclaimer()
+{
+	radix_tree_reclaimer reclaimer;
+	map_type map;
+	{
+		tree_type tree;
+		tree.set_reclaimer(&reclaimer);
+		fill(tree, map, 2000, 7);
+		tree.clear();
+		CHECK(tree.empty() && tree.begin() == tree.end());
+		map.clear();
+		fill(tree, map, 500, 8);
+		CHECK(same(tree, map));
+	}
+	reclaimer.drain();
+	CHECK(reclaimer.pending() == 0);
+}
+
+int main()
+{
+	test_random_operations();
+	test_move_only();
+	test_bulk_load();
+	test_merge(false);
+	test_merge(true);
+	test_split(false);
+	test_split(true);
+	test_erase_prefix_remove_if();
+	test_fuzzy();
+	test_counters();
+	test_reclaimer();
+	return test_exit("test_radix_tree");
+}
@@ -0,0 +1,153 @@
+// Checks radix_route_table against a std::map of routes: every longest prefix
+// match is compared with a search over all prefix lengths of the address, for
+// IPv4 and IPv6 tables with several stride layouts, while routes come and go.
+#include <map>
+#include <new>
+#include <random>
+#include <utility>
+
+#include "radix_tree_route.hpp"
+#include "test_check.hpp"
+
+static std::mt19937_64 rng(4242);
+
+static std::uint32_t random_address(std::uint32_t*)
+{
+	// a few /8s, so that routes nest and share tables
+	return (static_cast<std::uint32_t>(rng() % 4) << 24) | static_cast<std::uint32_t>(rng() & 0xFFFFFF);
+}
+
+static radix_uint128 random_address(radix_uint128*)
+{
+	return radix_uint128(0x20010db800000000ull | (rng() % 4) << 32 | (rng() & 0xFFFF), rng());
+}
+
+// route lengths crowd around the stride boundaries and the common lengths
+static int random_length(int bits)
+{
+	return rng() % 4 == 0 ? static_cast<int>(rng() % (bits + 1)) : static_cast<int>(rng() % (bits / 4 + 1)) + (bits == 32 ? 8 : 24);
+}
+
+template<class Table>
+static void check_table()
+{
+	typedef typename Table::address_type addr_type;
+	typedef typename Table::key_traits traits;
+	typedef std::map<std::pair<addr_type, int>, int> map_type;
+	const int bits = traits::bits;
+
+	Table table;
+	map_type routes;
+	CHECK(table.empty() && table.longest_match(random_address(static_cast<addr_type*>(NULL))) == NULL);
+
+	for (int op = 0; op < 20000; op++) {
+		addr_type addr = random_address(static_cast<addr_type*>(NULL));
+		int len = random_length(bits);
+		std::pair<addr_type, int> key(traits::mask(addr, len), len);
+		int value = op;
+
+		switch (rng() % 4) {
+		case 0:
+		case 1: {
+			// bits after the prefix length are ignored
+			bool fresh = routes.insert(std::make_pair(key, value)).second;
+			CHECK(table.insert(addr, len, value) == fresh);
+			break;
+		}
+		case 2: {
+			bool had = routes.erase(key) != 0;
+			CHECK(table.erase(addr, len) == had);
+			break;
+		}
+		default: {
+			typename map_type::const_iterator r = routes.find(key);
+			const int* found = table.find(addr, len);
+			CHECK((found == NULL) == (r == routes.end()));
+			CHECK(found == NULL || r == routes.end() || *found == r->second);
+			break;
+		}
+		}
+
+		// the longest route containing an address
+		addr = random_address(static_cast<addr_type*>(NULL));
+		typename map_type::const_iterator best = routes.end();
+		for (int l = bits; l >= 0 && best == routes.end(); l--)
+			best = routes.find(std::make_pair(traits::mask(addr, l), l));
+		int match_len = -1;
+		const int* value_found = table.longest_match(addr, &match_len);
+		CHECK((value_found == NULL) == (best == routes.end()));
+		if (value_found != NULL && best != routes.end()) {
+			CHECK(*value_found == best->second);
+			CHECK(match_len == best->first.second);
+		}
+	}
+
+	CHECK(table.size() == routes.size());
+	CHECK(table.bytes() > 0);
+	typename map_type::const_iterator r = routes.begin();
+	bool ordered = true;
+	table.for_each([&](const addr_type& prefix, int len, const int& value) {
+		if (r == routes.end() || !(r->first.first == prefix) || r->first.second != len || r->second != value)
+			ordered = false;
+		else
+			++r;
+	});
+	CHECK(ordered && r == routes.end());
+
+	// a default route catches everything, and erasing it leaves nothing behind
+	CHECK(table.insert(addr_type(), 0, -1) == (routes.count(std::make_pair(addr_type(), 0)) == 0));
+	CHECK(table.longest_match(random_address(static_cast<addr_type*>(NULL))) != NULL);
+	table.clear();
+	CHECK(table.empty() && table.size() == 0);
+	CHECK(table.longest_match(random_address(static_cast<addr_type*>(NULL))) == NULL);
+}
+
+// a value whose copy can be made to fail
+struct fragile {
+	static bool fail;
+	int id;
+	explicit fragile(int i = 0) :id(i) { }
+	fragile(const fragile& other) :id(other.id)
+	{
+		if (fail)
+			throw std::bad_alloc();
+	}
+	fragile& operator=(const fragile& other) { id = other.id; return *this; }
+};
+
+bool fragile::fail = false;
+
+// an insert that throws leaves the table as it was
+static void test_throwing_insert()
+{
+	radix_ipv4_table<fragile> table;
+	fragile value(1);
+	CHECK(table.insert(0x0a000000u, 8, value));
+
+	fragile::fail = true;
+	bool thrown = false;
+	try {
+		table.insert(0x0a010000u, 16, value);
+	}
+	catch (const std::bad_alloc&) {
+		thrown = true;
+	}
+	fragile::fail = false;
+
+	CHECK(thrown);
+	CHECK(table.size() == 1 && table.find(0x0a010000u, 16) == NULL);
+	CHECK(table.longest_match(0x0a010203u)->id == 1);
+	CHECK(table.insert(0x0a010000u, 16, fragile(2)));
+	CHECK(table.size() == 2 && table.longest_match(0x0a010203u)->id == 2);
+}
+
+int main()
+{
+	check_table<radix_ipv4_table<int> >();
+	check_table<radix_route_table<std::uint32_t, int, 16, 4, 4, 4, 4> >();
+	check_table<radix_route_table<std::uint32_t, int, 8, 8, 8, 8> >();
+	check_table<radix_route_table<std::uint32_t, int, 24, 8> >();
+	check_table<radix_ipv6_table<int> >();
+	test_throwing_insert();
+	return test_exit("test_route");
+}